@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+"""Compares two gravity_bench JSON results and flags regressions.
+
+    python3 bench/compare.py before.json after.json [--threshold 0.1]
+
+Prints the change in ns/op of every benchmark present in both files. A benchmark regresses when its median got
+slower by more than the threshold and the new fastest repetition is also slower than the old slowest one, so a
+single noisy repetition isn't enough. Exits with 1 if anything regressed.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        results = json.load(f)
+    return results.get("context", {}), {b["name"]: b for b in results["benchmarks"]}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare two gravity_bench JSON files")
+    parser.add_argument("before")
+    parser.add_argument("after")
+    parser.add_argument("--threshold", type=float, default=0.1,
+                        help="relative slowdown of the median that counts as a regression (default: 0.1)")
+    args = parser.parse_args()
+
+    before_context, before = load(args.before)
+    after_context, after = load(args.after)
+    for key in sorted(set(before_context) | set(after_context)):
+        if before_context.get(key) != after_context.get(key):
+            print(f"note: {key} differs, {before_context.get(key)} -> {after_context.get(key)}")
+
+    names = [name for name in after if name in before]
+    width = max([len(name) for name in names] + [9])
+    print(f"{'benchmark':<{width}}  {'before ns':>12}  {'after ns':>12}  {'change':>8}")
+
+    regressions = []
+    for name in names:
+        old = before[name]
+        new = after[name]
+        change = new["ns_per_op"] / old["ns_per_op"] - 1.0
+        flag = ""
+        if change > args.threshold and new["min_ns_per_op"] > old["max_ns_per_op"]:
+            flag = "  REGRESSION"
+            regressions.append(name)
+        elif change < -args.threshold and new["max_ns_per_op"] < old["min_ns_per_op"]:
+            flag = "  faster"
+        print(f"{name:<{width}}  {old['ns_per_op']:>12.4g}  {new['ns_per_op']:>12.4g}  {change:>+8.1%}{flag}")
+
+    for name in sorted(set(before) ^ set(after)):
+        print(f"{name}: only in {'before' if name in before else 'after'}")
+
+    if regressions:
+        print(f"\n{len(regressions)} regression(s) above {args.threshold:.0%}")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,427 @@
+// Micro and scaling benchmarks for the gravity core, written as JSON so runs can be compared with
+// bench/compare.py, e.g.
+//   gravity_bench --out before.json
+//   (change the engine, rebuild)
+//   gravity_bench --out after.json
+//   python3 bench/compare.py before.json after.json
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "force_kernel.hpp"
+#include "generators.hpp"
+#include "simulation.hpp"
+
+namespace
+{
+    struct BenchOptions
+    {
+        std::string Filter;
+        std::string Out;
+        double MinTime = 0.1;
+        unsigned int Repetitions = 5;
+        unsigned int MaxBodies = 10000;
+    };
+
+    struct BenchResult
+    {
+        std::string Name;
+        unsigned int Size;              // Bodies, or elements for the vector benchmarks
+        unsigned long long Iterations;  // Operations per repetition
+        double MedianNs;                // Per operation
+        double MinNs;
+        double MaxNs;
+    };
+
+    // Results of the benchmarked code are folded into this so the compiler can't drop the work
+    volatile double g_sink = 0.0;
+
+    const unsigned int BODY_COUNTS[] = { 10, 100, 1000, 10000 };
+
+    const Simulation::IntegrationMethod INTEGRATORS[] = {
+        Simulation::IntegrationMethod::Euler,
+        Simulation::IntegrationMethod::Taylor,
+        Simulation::IntegrationMethod::Leapfrog,
+        Simulation::IntegrationMethod::Yoshida,
+        Simulation::IntegrationMethod::Omelyan,
+        Simulation::IntegrationMethod::Hermite
+    };
+
+    const char* IntegratorName(Simulation::IntegrationMethod integrator)
+    {
+        switch (integrator)
+        {
+            case Simulation::IntegrationMethod::Euler:
+                return "euler";
+            case Simulation::IntegrationMethod::Taylor:
+                return "taylor";
+            case Simulation::IntegrationMethod::Yoshida:
+                return "yoshida";
+            case Simulation::IntegrationMethod::Omelyan:
+                return "omelyan";
+            case Simulation::IntegrationMethod::Hermite:
+                return "hermite";
+            default:
+                return "leapfrog";
+        }
+    }
+
+    // A virialised Plummer sphere in N-body units, the same bodies for every run
+    std::unique_ptr<Simulation> MakeSimulation(unsigned int bodies, bool soften,
+                                               Simulation::IntegrationMethod integrator = Simulation::IntegrationMethod::Leapfrog)
+    {
+        auto sim = std::make_unique<Simulation>(integrator);
+        sim->G(1.0);
+        sim->dt(0.001);
+        sim->soften(soften);
+        sim->Threads(1);
+        GeneratePlummer(*sim, bodies, 1.0, 1.0, 0.001, 42);
+        return sim;
+    }
+
+    class BenchRunner
+    {
+    public:
+        explicit BenchRunner(const BenchOptions& options) : m_options(options) {}
+
+        bool Selected(const std::string& name) const
+        {
+            return m_options.Filter.empty() || name.find(m_options.Filter) != std::string::npos;
+        }
+
+        // Times op, which performs opsPerCall operations each call. The call count is doubled until a
+        // repetition takes at least MinTime, then the repetitions are timed with that count.
+        void Run(const std::string& name, unsigned int size, unsigned long long opsPerCall,
+                 const std::function<void()>& op)
+        {
+            if (!Selected(name))
+            {
+                return;
+            }
+
+            op();  // Warm up (first force pass, allocations)
+            unsigned long long calls = 1;
+            while (Time(op, calls) < m_options.MinTime && calls < (1ull << 40))
+            {
+                calls *= 2;
+            }
+
+            std::vector<double> perOp;
+            for (unsigned int r = 0; r < std::max(m_options.Repetitions, 1u); ++r)
+            {
+                perOp.push_back(Time(op, calls) * 1e9 / static_cast<double>(calls * opsPerCall));
+            }
+            std::sort(perOp.begin(), perOp.end());
+            const std::size_t mid = perOp.size() / 2;
+            const double median = perOp.size() % 2 ? perOp[mid] : 0.5 * (perOp[mid - 1] + perOp[mid]);
+
+            m_results.push_back({ name, size, calls * opsPerCall, median, perOp.front(), perOp.back() });
+            std::cerr << name << ": " << median << " ns/op\n";
+        }
+
+        const std::vector<BenchResult>& Results() const { return m_results; }
+
+    private:
+        static double Time(const std::function<void()>& op, unsigned long long calls)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            for (unsigned long long i = 0; i < calls; ++i)
+            {
+                op();
+            }
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        const BenchOptions& m_options;
+        std::vector<BenchResult> m_results;
+    };
+
+    void VectorBenchmarks(BenchRunner& runner)
+    {
+        const std::size_t count = 1024;
+        std::vector<Vector2> a(count);
+        std::vector<Vector2> b(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            a[i] = Vector2(std::sin(0.1 * i), std::cos(0.3 * i));
+            b[i] = Vector2(std::cos(0.7 * i), 1.0 + std::sin(0.2 * i));
+        }
+
+        runner.Run("vector/add", count, count, [&]()
+        {
+            Vector2 sum;
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                sum += a[i] + b[i];
+            }
+            g_sink = g_sink + sum[0];
+        });
+
+        runner.Run("vector/scale_add", count, count, [&]()
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                a[i] += b[i] * 1e-9;
+            }
+            g_sink = g_sink + a[0][0];
+        });
+
+        runner.Run("vector/norm", count, count, [&]()
+        {
+            double sum = 0.0;
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                sum += a[i].Norm();
+            }
+            g_sink = g_sink + sum;
+        });
+    }
+
+    void BodyBenchmarks(BenchRunner& runner)
+    {
+        const unsigned int bodies = 100;
+        for (bool soften : { false, true })
+        {
+            const std::string suffix = soften ? "/soft" : "/hard";
+            auto sim = MakeSimulation(bodies, soften);
+            std::vector<Body> views = sim->Bodies();
+            runner.Run("body/force_exerted_by" + suffix, bodies, bodies * (bodies - 1), [&]()
+            {
+                Vector2 sum;
+                for (std::size_t i = 0; i < views.size(); ++i)
+                {
+                    for (std::size_t j = 0; j < views.size(); ++j)
+                    {
+                        if (i != j)
+                        {
+                            sum += views[i].ForceExertedBy(views[j], 1.0, soften);
+                        }
+                    }
+                }
+                g_sink = g_sink + sum[0];
+            });
+        }
+    }
+
+    void SimulationBenchmarks(BenchRunner& runner, unsigned int maxBodies)
+    {
+        for (unsigned int bodies : BODY_COUNTS)
+        {
+            if (bodies > maxBodies)
+            {
+                continue;
+            }
+            const std::string size = "/" + std::to_string(bodies);
+            for (bool soften : { false, true })
+            {
+                const std::string suffix = (soften ? "/soft" : "/hard") + size;
+
+                // Cost per body, the whole set is evaluated each call
+                const std::string totalForce = "simulation/total_force" + suffix;
+                if (runner.Selected(totalForce))
+                {
+                    auto sim = MakeSimulation(bodies, soften);
+                    runner.Run(totalForce, bodies, bodies, [&]()
+                    {
+                        double sum = 0.0;
+                        for (unsigned int i = 0; i < bodies; ++i)
+                        {
+                            sum += sim->CalculateTotalForceOnBody(i, soften)[0];
+                        }
+                        g_sink = g_sink + sum;
+                    });
+                }
+
+                const std::string energy = "simulation/energy" + suffix;
+                if (runner.Selected(energy))
+                {
+                    auto sim = MakeSimulation(bodies, soften);
+                    runner.Run(energy, bodies, 1, [&]() { g_sink = g_sink + sim->Energy(); });
+                }
+
+                for (auto integrator : INTEGRATORS)
+                {
+                    const std::string update = std::string("simulation/update/") + IntegratorName(integrator) + suffix;
+                    if (!runner.Selected(update))
+                    {
+                        continue;
+                    }
+                    auto sim = MakeSimulation(bodies, soften, integrator);
+                    runner.Run(update, bodies, 1, [&]() { sim->Update(); });
+                }
+            }
+
+            // Cost per body of sorting along the Morton curve, after the first call the order barely changes as
+            // it would between reorders every few steps
+            const std::string reorder = "simulation/reorder" + size;
+            if (runner.Selected(reorder))
+            {
+                auto sim = MakeSimulation(bodies, true);
+                runner.Run(reorder, bodies, bodies, [&]() { sim->ReorderBodies(); });
+            }
+
+            // A body removed by id and added back, which should cost the same at any size
+            const std::string removeAdd = "simulation/remove_add" + size;
+            if (runner.Selected(removeAdd))
+            {
+                auto sim = MakeSimulation(bodies, true);
+                std::size_t next = 0;
+                runner.Run(removeAdd, bodies, 1, [&]()
+                {
+                    const BodyStore& store = sim->Store();
+                    const std::size_t i = next++ % store.Size();
+                    const double mass = store.Mass[i];
+                    const double radius = store.Radius[i];
+                    const Vector2 position(store.X[i], store.Y[i]);
+                    const Vector2 velocity(store.VX[i], store.VY[i]);
+                    sim->RemoveBody(store.Id[i]);
+                    sim->AddBody(mass, radius, position, velocity);
+                });
+            }
+
+            // Nine in ten of the bodies static, so the step is mostly the cached static field
+            const std::string attractors = "simulation/update/attractors" + size;
+            if (runner.Selected(attractors))
+            {
+                Simulation sim;
+                sim.G(1.0);
+                sim.dt(0.001);
+                sim.soften(true);
+                sim.Threads(1);
+                GenerateAttractorField(sim, bodies - bodies / 10, bodies / 10, 1.0, 1.0, 0.001, 42);
+                // The field is built by the first step, outside the timing
+                sim.Update();
+                runner.Run(attractors, bodies, 1, [&]() { sim.Update(); });
+            }
+        }
+    }
+
+    void PrintUsage(const char* exe)
+    {
+        std::cout << "Usage: " << exe << " [options]\n"
+                  << "  --filter <text>               Only run benchmarks whose name contains text\n"
+                  << "  --min-time <s>                Minimum time per repetition (default: 0.1)\n"
+                  << "  --repetitions <n>             Timed repetitions, the median is reported (default: 5)\n"
+                  << "  --max-bodies <n>              Skip simulation benchmarks above n bodies (default: 10000)\n"
+                  << "  --out <file>                  Write the JSON results to file instead of stdout\n"
+                  << "  --help                        Show this message\n";
+    }
+
+    bool ParseArgs(int argc, char** argv, BenchOptions& options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h")
+            {
+                PrintUsage(argv[0]);
+                std::exit(EXIT_SUCCESS);
+            }
+
+            if (i + 1 >= argc)
+            {
+                std::cerr << "Missing value for " << arg << "\n";
+                return false;
+            }
+            const std::string value = argv[++i];
+
+            if (arg == "--filter")
+            {
+                options.Filter = value;
+            }
+            else if (arg == "--min-time")
+            {
+                options.MinTime = std::stod(value);
+            }
+            else if (arg == "--repetitions")
+            {
+                options.Repetitions = static_cast<unsigned int>(std::stoul(value));
+            }
+            else if (arg == "--max-bodies")
+            {
+                options.MaxBodies = static_cast<unsigned int>(std::stoul(value));
+            }
+            else if (arg == "--out")
+            {
+                options.Out = value;
+            }
+            else
+            {
+                std::cerr << "Unknown option " << arg << "\n";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void WriteJson(std::ostream& os, const BenchOptions& options, const std::vector<BenchResult>& results)
+    {
+        os.precision(6);
+        os << "{\n"
+           << "  \"context\": {\n"
+           << "    \"kernel\": \"" << DirectSumKernelName() << "\",\n"
+#ifdef NDEBUG
+           << "    \"optimised\": true,\n"
+#else
+           << "    \"optimised\": false,\n"
+#endif
+           << "    \"min_time\": " << options.MinTime << ",\n"
+           << "    \"repetitions\": " << options.Repetitions << "\n"
+           << "  },\n"
+           << "  \"benchmarks\": [";
+        for (std::size_t i = 0; i < results.size(); ++i)
+        {
+            const BenchResult& result = results[i];
+            os << (i == 0 ? "\n" : ",\n")
+               << "    { \"name\": \"" << result.Name << "\", \"size\": " << result.Size
+               << ", \"iterations\": " << result.Iterations << ", \"ns_per_op\": " << result.MedianNs
+               << ", \"min_ns_per_op\": " << result.MinNs << ", \"max_ns_per_op\": " << result.MaxNs << " }";
+        }
+        os << "\n  ]\n}\n";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    try
+    {
+        if (!ParseArgs(argc, argv, options))
+        {
+            PrintUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Invalid argument: " << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    BenchRunner runner(options);
+    VectorBenchmarks(runner);
+    BodyBenchmarks(runner);
+    SimulationBenchmarks(runner, options.MaxBodies);
+
+    if (options.Out.empty())
+    {
+        WriteJson(std::cout, options, runner.Results());
+        return EXIT_SUCCESS;
+    }
+    std::ofstream file(options.Out);
+    if (!file)
+    {
+        std::cerr << "Couldn't open " << options.Out << "\n";
+        return EXIT_FAILURE;
+    }
+    WriteJson(file, options, runner.Results());
+    return EXIT_SUCCESS;
+}
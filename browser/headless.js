@@ -0,0 +1,106 @@
+// Runs the worker hosted simulation under Node worker_threads with no page, reading the published states
+// the way index.html does, and checks that every state read is whole and newer than the last. Needs the
+// wasm module built into this directory (see readme).
+//
+//   node browser/headless.js [--bodies 2000] [--seconds 5] [--rate 0]
+//
+// --rate is the steps per second the worker aims for, 0 (the default) steps flat out. Exits with an error
+// if a torn or out of order state is seen.
+
+const path = require('path');
+const { Worker } = require('worker_threads');
+const Shared = require('./shared_state.js');
+
+function parseArgs(argv) {
+    const options = { bodies: 2000, seconds: 5, rate: 0, trails: 20 };
+    for (let i = 2; i + 1 < argv.length; i += 2) {
+        const name = argv[i].replace(/^--/, '');
+        if (!(name in options)) {
+            throw new Error(`Unknown option ${argv[i]}`);
+        }
+        options[name] = Number(argv[i + 1]);
+    }
+    return options;
+}
+
+function main() {
+    const options = parseArgs(process.argv);
+    const state = Shared.SharedSimState.create(options.bodies, options.trails);
+    const reader = new Shared.StateReader(state);
+    const worker = new Worker(path.join(__dirname, 'sim_worker.js'));
+
+    worker.on('error', (error) => {
+        console.error(error);
+        process.exit(1);
+    });
+
+    worker.on('message', (message) => {
+        if (message.type !== 'ready') {
+            return;
+        }
+
+        // Reads like a renderer would, as fast as it can for the given time, on this thread while the
+        // worker steps on its own
+        let reads = 0;
+        let newStates = 0;
+        let errors = 0;
+        let lastSequence = 0;
+        let firstStep = -1;
+        let lastStep = 0;
+        const start = Date.now();
+        while (Date.now() - start < 1000 * options.seconds) {
+            reader.waitForSequence(lastSequence, 50);
+            const slot = reader.acquire();
+            ++reads;
+
+            const sequence = Shared.sequence(slot);
+            if (sequence < lastSequence) {
+                console.error(`State ${sequence} read after ${lastSequence}`);
+                ++errors;
+            }
+            if (sequence > lastSequence) {
+                ++newStates;
+            }
+            lastSequence = sequence;
+
+            let sum = 0.0;
+            const count = Shared.count(slot);
+            for (let i = 0; i < count; i++) {
+                sum += slot.x[i];
+            }
+            if (sum !== Shared.checksum(slot)) {
+                console.error(`Torn state ${sequence}: checksum ${sum} != ${Shared.checksum(slot)}`);
+                ++errors;
+            }
+
+            if (firstStep < 0) {
+                firstStep = Shared.step(slot);
+            }
+            lastStep = Shared.step(slot);
+        }
+        const seconds = (Date.now() - start) / 1000;
+
+        worker.postMessage({ type: 'stop' });
+        worker.terminate();
+
+        console.log(`Bodies:            ${message.bodyCount}`);
+        console.log(`Steps:             ${lastStep - firstStep}`);
+        console.log(`Steps/sec:         ${((lastStep - firstStep) / seconds).toFixed(1)}`);
+        console.log(`States published:  ${state.sequence()}`);
+        console.log(`States read:       ${newStates} (${reads} reads)`);
+        console.log(`Errors:            ${errors}`);
+        process.exit(errors > 0 ? 1 : 0);
+    });
+
+    worker.postMessage({
+        type: 'init',
+        buffer: state.buffer,
+        // bodies, scale radius, total mass, body radius, seed
+        setup: { G: 1, dt: 0.001, soften: true, generator: 'generatePlummer', args: [options.bodies, 1, 1, 0.001, 42] },
+        trailLength: options.trails,
+        stepsPerSecond: options.rate,
+        verify: true
+    });
+}
+
+main();
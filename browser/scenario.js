@@ -0,0 +1,54 @@
+// The bodies the page starts with, shared by index.html and sim_worker.js so the in-page and worker modes
+// run the same thing. Uncomment one of the setups to try it. Starts with the simulation paused.
+function setupScenario(sim, Module) {
+    sim.soften(true);
+    sim.pause();
+
+    // // Setup an oscillating pair of bodies
+    // sim.setG(5000);
+    // sim.setDt(0.01);
+    // sim.addBody(100, 1.0, new Module.Vector2(150, 0),  new Module.Vector2(0, -300), false);
+    // sim.addBody(100, 1.0, new Module.Vector2(-150, 0),  new Module.Vector2(0, 300), false);
+
+    // // Setup 3 bodies
+    // sim.setG(5000);
+    // sim.setDt(0.01);
+    // sim.addBody(100, 1.0, new Module.Vector2(150, 0),  new Module.Vector2(0, -300), false);
+    // sim.addBody(100, 1.0, new Module.Vector2(-150, 0),  new Module.Vector2(0, 300), false);
+    // sim.addBody(100, 1.0, new Module.Vector2(0, 150),  new Module.Vector2(300, 0), false);
+
+    // Setup 4 bodies
+    sim.setG(5000);
+    sim.setDt(0.01);
+    const initRadius = 250;
+    const initVel = 150;
+    sim.addBody(100, 1.0, new Module.Vector2(initRadius, 0),  new Module.Vector2(0, -initVel), false);
+    sim.addBody(100, 1.0, new Module.Vector2(-initRadius, 0),  new Module.Vector2(0, initVel), false);
+    sim.addBody(100, 1.0, new Module.Vector2(0, initRadius),  new Module.Vector2(initVel, 0), false);
+    sim.addBody(100, 1.0, new Module.Vector2(0, -initRadius),  new Module.Vector2(-initVel, 0), false);
+
+    // Circle of bodies
+    // sim.setG(5000);
+    // sim.setDt(0.001);
+    // // count, inner radius, outer radius, min/max mass, body radius, min/max speed, seed
+    // Module.generateRing(sim, 2000, 1, 500, 1, 1, 0.5, 100, 100, 42);
+
+    // Lots of bodies around a central massive object
+    // sim.setG(500);
+    // const numBodies = 1000;
+    // // Add a large central body
+    // sim.addBody(1e4, 5.0, new Module.Vector2(0.0, 0.0), new Module.Vector2(0.0, 0.0), true);
+    // // Add a smaller ring of bodies
+    // Module.generateRing(sim, numBodies - 1, 350, 450, 25.0, 75.0, 0.5, 4000, 4050, 42);
+
+    // Two colliding galaxies
+    // sim.setG(5000);
+    // sim.setDt(0.001);
+    // sim.setSolver(Module.ForceSolver.BarnesHut);
+    // // bodies per galaxy, disk radius, galaxy mass, separation, approach speed, body radius, seed
+    // Module.generateGalaxyCollision(sim, 5000, 200, 500, 800, 500, 0.5, 42);
+}
+
+if (typeof module !== 'undefined' && module.exports) {
+    module.exports = { setupScenario: setupScenario };
+}
@@ -0,0 +1,171 @@
+// Simulation state shared between the worker that steps the simulation and the thread that draws it,
+// without copies on the reading side or locks on either. The SharedArrayBuffer holds three slots, each a
+// complete published state: the worker fills its back slot and swaps it into the middle, the reader swaps
+// the middle out to its front slot when there is a newer one (the classic lock free triple buffer). Both
+// swaps are one Atomics.exchange on the control word, so each side always owns a slot the other can't
+// touch and the reader never sees a half written state.
+//
+// Loaded with a <script> tag or importScripts (defines self.GravityShared) or required from Node.
+(function (root) {
+    // Int32 header
+    const CONTROL = 0;          // Index of the middle slot, plus FRESH when it holds a state the reader hasn't taken
+    const SEQUENCE = 1;         // Number of states published, Atomics.wait on it for the next one
+    const CAPACITY = 2;         // Bodies per slot
+    const TRAIL_LENGTH = 3;     // Trail samples per body per slot
+    const HEADER_BYTES = 16;
+    const FRESH = 4;
+    const SLOTS = 3;
+
+    // Float64 metadata at the start of each slot
+    const META_SEQUENCE = 0;
+    const META_STEP = 1;
+    const META_TIME = 2;
+    const META_COUNT = 3;       // Bodies in this state, at most the capacity
+    const META_BODY_COUNT = 4;  // Bodies in the simulation, more than count if it didn't fit
+    const META_TRAIL_HEAD = 5;
+    const META_COM_X = 6;
+    const META_COM_Y = 7;
+    const META_CHECKSUM = 8;    // Sum of x, only filled in when the writer verifies
+    const META_SIZE = 9;
+
+    function slotDoubles(capacity, trailLength) {
+        return META_SIZE + 3 * capacity + 2 * trailLength * capacity;
+    }
+
+    class SharedSimState {
+        // Room for capacity bodies with trailLength trail samples each
+        static create(capacity, trailLength) {
+            const bytes = HEADER_BYTES + SLOTS * 8 * slotDoubles(capacity, trailLength);
+            const state = new SharedSimState(new SharedArrayBuffer(bytes), capacity, trailLength);
+            Atomics.store(state.header, CONTROL, 1);
+            return state;
+        }
+
+        constructor(buffer, capacity, trailLength) {
+            this.buffer = buffer;
+            this.header = new Int32Array(buffer, 0, HEADER_BYTES / 4);
+            if (capacity !== undefined) {
+                this.header[CAPACITY] = capacity;
+                this.header[TRAIL_LENGTH] = trailLength;
+            }
+            this.capacity = this.header[CAPACITY];
+            this.trailLength = this.header[TRAIL_LENGTH];
+
+            const doubles = slotDoubles(this.capacity, this.trailLength);
+            this.slots = [];
+            for (let s = 0; s < SLOTS; s++) {
+                let offset = HEADER_BYTES + 8 * s * doubles;
+                const slot = {};
+                slot.meta = new Float64Array(buffer, offset, META_SIZE);
+                offset += 8 * META_SIZE;
+                slot.x = new Float64Array(buffer, offset, this.capacity);
+                offset += 8 * this.capacity;
+                slot.y = new Float64Array(buffer, offset, this.capacity);
+                offset += 8 * this.capacity;
+                slot.radius = new Float64Array(buffer, offset, this.capacity);
+                offset += 8 * this.capacity;
+                slot.trails = new Float64Array(buffer, offset, 2 * this.trailLength * this.capacity);
+                this.slots.push(slot);
+            }
+        }
+
+        sequence() {
+            return Atomics.load(this.header, SEQUENCE);
+        }
+    }
+
+    // Worker side, publishes states of a wasm Simulation
+    class StateWriter {
+        constructor(state, verify) {
+            this.state = state;
+            this.back = 2;
+            this.verify = !!verify;
+        }
+
+        publish(sim) {
+            const state = this.state;
+            const slot = state.slots[this.back];
+            const bodyCount = sim.bodyCount();
+            const count = Math.min(bodyCount, state.capacity);
+
+            // The engine's views are only valid until the next call into the module, copy straight away
+            slot.x.set(sim.positionsX().subarray(0, count));
+            slot.y.set(sim.positionsY().subarray(0, count));
+            slot.radius.set(sim.radii().subarray(0, count));
+            const trailValues = 2 * state.trailLength * count;
+            if (trailValues > 0 && sim.getTrailLength() === state.trailLength) {
+                slot.trails.set(sim.trails().subarray(0, trailValues));
+            }
+
+            const meta = slot.meta;
+            meta[META_STEP] = sim.stepCount();
+            meta[META_TIME] = sim.time();
+            meta[META_COUNT] = count;
+            meta[META_BODY_COUNT] = bodyCount;
+            meta[META_TRAIL_HEAD] = sim.trailHead();
+            if (bodyCount > 0) {
+                const com = sim.centerOfMass();
+                meta[META_COM_X] = com.at(0);
+                meta[META_COM_Y] = com.at(1);
+                com.delete();
+            }
+            if (this.verify) {
+                let sum = 0.0;
+                for (let i = 0; i < count; i++) {
+                    sum += slot.x[i];
+                }
+                meta[META_CHECKSUM] = sum;
+            }
+            meta[META_SEQUENCE] = Atomics.load(state.header, SEQUENCE) + 1;
+
+            // The exchange orders the writes above before the reader's exchange that takes this slot
+            this.back = Atomics.exchange(state.header, CONTROL, this.back | FRESH) & 3;
+            Atomics.add(state.header, SEQUENCE, 1);
+            Atomics.notify(state.header, SEQUENCE);
+        }
+    }
+
+    // Drawing side. The slot returned by acquire stays untouched until the next acquire.
+    class StateReader {
+        constructor(state) {
+            this.state = state;
+            this.front = 0;
+        }
+
+        // Latest published state (the previous one again if nothing new has been published), read it
+        // through the accessors below
+        acquire() {
+            if (Atomics.load(this.state.header, CONTROL) & FRESH) {
+                this.front = Atomics.exchange(this.state.header, CONTROL, this.front) & 3;
+            }
+            return this.state.slots[this.front];
+        }
+
+        // Blocks until more than sequence states have been published or timeoutMs passes. Not allowed on
+        // the browser's main thread, use it from workers and Node.
+        waitForSequence(sequence, timeoutMs) {
+            return Atomics.wait(this.state.header, SEQUENCE, sequence, timeoutMs);
+        }
+    }
+
+    const api = {
+        SharedSimState: SharedSimState,
+        StateWriter: StateWriter,
+        StateReader: StateReader,
+        sequence: (slot) => slot.meta[META_SEQUENCE],
+        step: (slot) => slot.meta[META_STEP],
+        time: (slot) => slot.meta[META_TIME],
+        count: (slot) => slot.meta[META_COUNT],
+        bodyCount: (slot) => slot.meta[META_BODY_COUNT],
+        trailHead: (slot) => slot.meta[META_TRAIL_HEAD],
+        centerX: (slot) => slot.meta[META_COM_X],
+        centerY: (slot) => slot.meta[META_COM_Y],
+        checksum: (slot) => slot.meta[META_CHECKSUM]
+    };
+
+    if (typeof module !== 'undefined' && module.exports) {
+        module.exports = api;
+    } else {
+        root.GravityShared = api;
+    }
+})(typeof self !== 'undefined' ? self : this);
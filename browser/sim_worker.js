@@ -0,0 +1,139 @@
+// Steps a wasm Simulation continuously and publishes every completed state into a SharedSimState (see
+// shared_state.js), so the page can draw at its own rate without waiting on the physics. Runs as a browser
+// Web Worker or a Node worker_threads worker (see headless.js).
+//
+// Messages in:
+//   { type: 'init', buffer, setup, trailLength, stepsPerSecond, verify }
+//       buffer          SharedSimState.buffer to publish into
+//       setup           'page' for the page's setupScenario (scenario.js), or
+//                       { G, dt, soften, solver, generator, args } to call Module[generator](sim, ...args)
+//       trailLength     Trail samples recorded per body (0 for none)
+//       stepsPerSecond  Steps per second of wall clock, 0 to step as fast as possible
+//       verify          Fill in the x checksum of each state, for tests
+//   { type: 'pause' }   Toggles pause, like Simulation.pause
+//   { type: 'reset' }
+//   { type: 'stop' }    Stops stepping, the worker can then be terminated
+// Messages out:
+//   { type: 'ready', bodyCount }
+
+const isNode = typeof process !== 'undefined' && process.versions != null && process.versions.node != null;
+
+let port = null;
+let Shared = null;
+let setupScenario = null;
+let modulePromise = null;
+
+if (isNode) {
+    const { parentPort } = require('worker_threads');
+    port = parentPort;
+    Shared = require('./shared_state.js');
+    setupScenario = require('./scenario.js').setupScenario;
+    modulePromise = new Promise((resolve) => {
+        const Module = require('./gravity_lib.js');
+        if (Module.calledRun) {
+            resolve(Module);
+        } else {
+            Module.onRuntimeInitialized = () => resolve(Module);
+        }
+    });
+} else {
+    port = self;
+    modulePromise = new Promise((resolve) => {
+        self.Module = { onRuntimeInitialized: () => resolve(self.Module) };
+    });
+    importScripts('shared_state.js', 'scenario.js', 'gravity_lib.js');
+    Shared = self.GravityShared;
+    setupScenario = self.setupScenario;
+}
+
+let sim = null;
+let writer = null;
+let stepsPerSecond = 60;
+let stopped = false;
+let lastTime = 0;
+
+// Physics gets this long at a time before the worker looks at its messages again
+const BUDGET_MS = 8;
+
+function createSimulation(Module, setup) {
+    const simulation = new Module.Simulation();
+    if (setup === 'page') {
+        setupScenario(simulation, Module);
+        return simulation;
+    }
+    simulation.setG(setup.G);
+    simulation.setDt(setup.dt);
+    simulation.soften(!!setup.soften);
+    if (setup.solver) {
+        simulation.setSolver(Module.ForceSolver[setup.solver]);
+    }
+    Module[setup.generator](simulation, ...setup.args);
+    return simulation;
+}
+
+function run() {
+    if (stopped) {
+        return;
+    }
+    const now = performance.now();
+    const elapsedSeconds = Math.min((now - lastTime) / 1000, 0.1);
+    lastTime = now;
+
+    let steps = 0;
+    if (stepsPerSecond > 0) {
+        steps = sim.advance(elapsedSeconds * stepsPerSecond * sim.getDt(), BUDGET_MS);
+    } else {
+        // Flat out, a batch of steps that fits the budget
+        const start = performance.now();
+        while (!sim.isPaused() && performance.now() - start < BUDGET_MS) {
+            steps += sim.step(1);
+        }
+    }
+    if (steps > 0) {
+        writer.publish(sim);
+    }
+    // Yields so messages get through, the physics otherwise runs back to back (and idles while paused)
+    setTimeout(run, steps === 0 ? 1 : 0);
+}
+
+const onMessage = async (message) => {
+    // Messages that arrive before init has finished (pause/reset) are dropped
+    const data = isNode ? message : message.data;
+    switch (data.type) {
+        case 'init': {
+            const Module = await modulePromise;
+            const state = new Shared.SharedSimState(data.buffer);
+            sim = createSimulation(Module, data.setup);
+            sim.setTrailLength(data.trailLength || 0);
+            sim.setTrailInterval(1);
+            stepsPerSecond = data.stepsPerSecond === undefined ? 60 : data.stepsPerSecond;
+            writer = new Shared.StateWriter(state, data.verify);
+            // Publish the starting state so there's something to draw before the first step
+            writer.publish(sim);
+            port.postMessage({ type: 'ready', bodyCount: sim.bodyCount() });
+            lastTime = performance.now();
+            run();
+            break;
+        }
+        case 'pause':
+            if (sim) {
+                sim.pause();
+            }
+            break;
+        case 'reset':
+            if (sim) {
+                sim.reset();
+                writer.publish(sim);
+            }
+            break;
+        case 'stop':
+            stopped = true;
+            break;
+    }
+};
+
+if (isNode) {
+    port.on('message', onMessage);
+} else {
+    port.onmessage = onMessage;
+}
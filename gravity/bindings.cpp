@@ -1,7 +1,180 @@
 #include <emscripten/bind.h>
+#include <emscripten/heap.h>
 
+#include "generators.hpp"
 #include "simulation.hpp"
 
+namespace
+{
+    // Zero-copy views over the body columns, these alias the wasm heap so they are only valid until the
+    // storage generation changes (bodies added/removed) or the heap grows
+    emscripten::val ColumnView(const std::vector<double>& column)
+    {
+        return emscripten::val(emscripten::typed_memory_view(column.size(), column.data()));
+    }
+
+    emscripten::val PositionsX(const Simulation& sim) { return ColumnView(sim.Store().X); }
+    emscripten::val PositionsY(const Simulation& sim) { return ColumnView(sim.Store().Y); }
+    emscripten::val VelocitiesX(const Simulation& sim) { return ColumnView(sim.Store().VX); }
+    emscripten::val VelocitiesY(const Simulation& sim) { return ColumnView(sim.Store().VY); }
+    emscripten::val Masses(const Simulation& sim) { return ColumnView(sim.Store().Mass); }
+    emscripten::val Radii(const Simulation& sim) { return ColumnView(sim.Store().Radius); }
+    // Uint32Array of each body's id, which stays with the body as its index changes
+    emscripten::val Ids(const Simulation& sim)
+    {
+        const std::vector<unsigned int>& ids = sim.Store().Id;
+        return emscripten::val(emscripten::typed_memory_view(ids.size(), ids.data()));
+    }
+    // Interleaved x, y rings of trailLength() samples per body, see TrailBuffer. Same lifetime as the
+    // column views, and also invalidated by setTrailLength.
+    emscripten::val Trails(const Simulation& sim) { return ColumnView(sim.Trails().Data()); }
+    unsigned int TrailHead(const Simulation& sim) { return static_cast<unsigned int>(sim.Trails().Head()); }
+    unsigned int GetTrailLength(const Simulation& sim) { return static_cast<unsigned int>(sim.TrailLength()); }
+    void SetTrailLength(Simulation& sim, unsigned int samples) { sim.TrailLength(samples); }
+
+    // 64 bit integers would need BigInt support, a double is exact up to 2^53 steps
+    double StepCount(const Simulation& sim) { return static_cast<double>(sim.StepCount()); }
+    double MergeCount(const Simulation& sim) { return static_cast<double>(sim.MergeCount()); }
+
+    SimulationDiagnostics Diagnostics(const Simulation& sim) { return sim.Diagnostics(); }
+
+    // { enabled, steps, interactions, allocations, phases: { step: { calls, totalMs, maxMs }, forces: ... } },
+    // all zero except the step and interaction counts when built with GRAVITY_PROFILING off
+    emscripten::val Stats(const Simulation& sim)
+    {
+        const Profiler& profiler = sim.Profile();
+        emscripten::val phases = emscripten::val::object();
+        for (int p = 0; p < Profiler::Phase::PhaseCount; ++p)
+        {
+            const Profiler::Phase phase = static_cast<Profiler::Phase>(p);
+            const Profiler::PhaseStats& phaseStats = profiler.Stats(phase);
+            emscripten::val entry = emscripten::val::object();
+            entry.set("calls", static_cast<double>(phaseStats.Calls));
+            entry.set("totalMs", phaseStats.TotalMs);
+            entry.set("maxMs", phaseStats.MaxMs);
+            phases.set(Profiler::PhaseName(phase), entry);
+        }
+
+        emscripten::val stats = emscripten::val::object();
+        stats.set("enabled", Profiler::Enabled);
+        stats.set("steps", static_cast<double>(sim.StepCount()));
+        stats.set("interactions", static_cast<double>(sim.InteractionCount()));
+        stats.set("allocations", static_cast<double>(profiler.Allocations()));
+        stats.set("phases", phases);
+        return stats;
+    }
+
+    void ResetStats(Simulation& sim) { sim.Profile().Reset(); }
+
+    // [{ id, step, time, x, y, vx, vy, mass }] of the bodies culled since the last call (see CullEvent), which
+    // are then cleared
+    emscripten::val TakeCullEvents(Simulation& sim)
+    {
+        emscripten::val events = emscripten::val::array();
+        for (const CullEvent& cull : sim.CullEvents())
+        {
+            emscripten::val event = emscripten::val::object();
+            event.set("id", cull.Id);
+            event.set("step", static_cast<double>(cull.StepCount));
+            event.set("time", cull.Time);
+            event.set("x", cull.X);
+            event.set("y", cull.Y);
+            event.set("vx", cull.VX);
+            event.set("vy", cull.VY);
+            event.set("mass", cull.Mass);
+            events.call<void>("push", event);
+        }
+        sim.ClearCullEvents();
+        return events;
+    }
+
+    // Sizes and counts cross as doubles rather than size_t, which is a BigInt in a MEMORY64 build
+    std::size_t JsLength(const emscripten::val& array)
+    {
+        return static_cast<std::size_t>(array["length"].as<double>());
+    }
+
+    void Reserve(Simulation& sim, double maxBodies) { sim.Reserve(static_cast<std::size_t>(maxBodies)); }
+    double ReservedBodies(const Simulation& sim) { return static_cast<double>(sim.ReservedBodies()); }
+    unsigned int StaticCount(const Simulation& sim) { return static_cast<unsigned int>(sim.StaticCount()); }
+
+    // { bodies, scratch, trails, total } bytes held by the simulation (see SimulationMemory), plus the size of
+    // the whole wasm heap and the most it can grow to
+    emscripten::val MemoryUsage(const Simulation& sim)
+    {
+        const SimulationMemory memory = sim.MemoryUsage();
+        emscripten::val usage = emscripten::val::object();
+        usage.set("bodies", static_cast<double>(memory.Bodies));
+        usage.set("scratch", static_cast<double>(memory.Scratch));
+        usage.set("trails", static_cast<double>(memory.Trails));
+        usage.set("total", static_cast<double>(memory.Total));
+        usage.set("heap", static_cast<double>(emscripten_get_heap_size()));
+        usage.set("heapMax", static_cast<double>(emscripten_get_heap_max()));
+        return usage;
+    }
+
+    // Copies a JS typed array (or plain array) into wasm memory with a single TypedArray.set
+    std::vector<double> CopyFromJs(const emscripten::val& array, std::size_t count)
+    {
+        std::vector<double> values(count);
+        emscripten::val(emscripten::typed_memory_view(count, values.data())).call<void>("set", array);
+        return values;
+    }
+
+    // Checkpoints as Uint8Arrays, e.g. to keep in IndexedDB or offer as a download. The FS path versions
+    // (save/load) work too, on whatever file system the module was built with.
+    emscripten::val SaveCheckpoint(Simulation& sim)
+    {
+        GRAVITY_PROFILE_SCOPE(sim.Profile(), Bindings);
+        std::vector<unsigned char> buffer;
+        sim.Save(buffer);
+        // slice() copies out of the wasm heap, so the result outlives buffer
+        return emscripten::val(emscripten::typed_memory_view(buffer.size(), buffer.data())).call<emscripten::val>("slice");
+    }
+
+    // Throws a JS error if the data isn't a readable checkpoint
+    void LoadCheckpoint(Simulation& sim, const emscripten::val& data)
+    {
+        GRAVITY_PROFILE_SCOPE(sim.Profile(), Bindings);
+        const std::size_t size = JsLength(data);
+        std::vector<unsigned char> buffer(size);
+        emscripten::val(emscripten::typed_memory_view(size, buffer.data())).call<void>("set", data);
+        std::string error;
+        if (!sim.Load(buffer.data(), buffer.size(), error))
+        {
+            emscripten::val::global("Error").new_(error).throw_();
+        }
+    }
+
+    bool SaveFile(const Simulation& sim, const std::string& path)
+    {
+        std::string error;
+        return sim.Save(path, error);
+    }
+
+    bool LoadFile(Simulation& sim, const std::string& path)
+    {
+        std::string error;
+        return sim.Load(path, error);
+    }
+
+    // Bulk load from packed arrays of equal length, e.g. Float64Arrays
+    void AddBodiesFromArrays(Simulation& sim, const emscripten::val& mass, const emscripten::val& radius,
+                             const emscripten::val& x, const emscripten::val& y,
+                             const emscripten::val& vx, const emscripten::val& vy)
+    {
+        GRAVITY_PROFILE_SCOPE(sim.Profile(), Bindings);
+        const std::size_t count = JsLength(mass);
+        const auto massValues = CopyFromJs(mass, count);
+        const auto radiusValues = CopyFromJs(radius, count);
+        const auto xValues = CopyFromJs(x, count);
+        const auto yValues = CopyFromJs(y, count);
+        const auto vxValues = CopyFromJs(vx, count);
+        const auto vyValues = CopyFromJs(vy, count);
+        sim.AddBodies(count, massValues.data(), radiusValues.data(), xValues.data(), yValues.data(),
+                      vxValues.data(), vyValues.data());
+    }
+}
 
 EMSCRIPTEN_BINDINGS(Gravity) {
     emscripten::class_<Vector2>("Vector2")
@@ -10,12 +183,50 @@ EMSCRIPTEN_BINDINGS(Gravity) {
 
     emscripten::class_<Body>("Body")
             .function("position", emscripten::select_overload<Vector2() const>(&Body::Position))
-            .function("radius", emscripten::select_overload<double() const>(&Body::Radius));
+            .function("radius", emscripten::select_overload<double() const>(&Body::Radius))
+            .function("id", &Body::Id);
+
+    emscripten::enum_<Simulation::IntegrationMethod>("IntegrationMethod")
+            .value("Euler", Simulation::IntegrationMethod::Euler)
+            .value("Taylor", Simulation::IntegrationMethod::Taylor)
+            .value("Leapfrog", Simulation::IntegrationMethod::Leapfrog)
+            .value("Yoshida", Simulation::IntegrationMethod::Yoshida)
+            .value("Omelyan", Simulation::IntegrationMethod::Omelyan)
+            .value("Hermite", Simulation::IntegrationMethod::Hermite);
+
+    emscripten::enum_<Simulation::ForceSolver>("ForceSolver")
+            .value("DirectSum", Simulation::ForceSolver::DirectSum)
+            .value("BarnesHut", Simulation::ForceSolver::BarnesHut)
+            .value("ParticleMesh", Simulation::ForceSolver::ParticleMesh);
+
+    emscripten::enum_<Simulation::ForcePrecision>("ForcePrecision")
+            .value("Double", Simulation::ForcePrecision::Double)
+            .value("Mixed", Simulation::ForcePrecision::Mixed);
+
+    emscripten::enum_<Simulation::CullPolicy>("CullPolicy")
+            .value("Keep", Simulation::CullPolicy::Keep)
+            .value("Remove", Simulation::CullPolicy::Remove)
+            .value("Freeze", Simulation::CullPolicy::Freeze);
+    emscripten::value_object<SimulationDiagnostics>("SimulationDiagnostics")
+            .field("time", &SimulationDiagnostics::Time)
+            .field("kineticEnergy", &SimulationDiagnostics::KineticEnergy)
+            .field("potentialEnergy", &SimulationDiagnostics::PotentialEnergy)
+            .field("totalEnergy", &SimulationDiagnostics::TotalEnergy)
+            .field("momentumX", &SimulationDiagnostics::MomentumX)
+            .field("momentumY", &SimulationDiagnostics::MomentumY)
+            .field("angularMomentum", &SimulationDiagnostics::AngularMomentum);
 
     emscripten::class_<Simulation>("Simulation")
             .constructor()
-            .function("addBody", emscripten::select_overload<void(double, double, Vector2, Vector2, bool)>(&Simulation::AddBody))
+            .constructor<Simulation::IntegrationMethod>()
+            .function("integrator", &Simulation::Integrator)
+            .function("addBody", emscripten::select_overload<unsigned int(double, double, Vector2, Vector2, bool)>(&Simulation::AddBody))
+            .function("removeBody", &Simulation::RemoveBody)
             .function("update", &Simulation::Update)
+            .function("step", &Simulation::Step)
+            .function("advance", &Simulation::Advance)
+            .function("time", &Simulation::Time)
+            .function("stepCount", &StepCount)
             .function("reset", &Simulation::Reset)
             .function("pause", &Simulation::Pause)
             .function("isPaused", &Simulation::IsPaused)
@@ -25,17 +236,81 @@ EMSCRIPTEN_BINDINGS(Gravity) {
             .function("setG", emscripten::select_overload<void(double)>(&Simulation::G))
             .function("setGWithScales", emscripten::select_overload<void(double, double, double)>(&Simulation::G))
             .function("soften", &Simulation::soften)
+            .function("getSolver", emscripten::select_overload<Simulation::ForceSolver() const>(&Simulation::Solver))
+            .function("setSolver", emscripten::select_overload<void(Simulation::ForceSolver)>(&Simulation::Solver))
+            .function("getPrecision", emscripten::select_overload<Simulation::ForcePrecision() const>(&Simulation::Precision))
+            .function("setPrecision", emscripten::select_overload<void(Simulation::ForcePrecision)>(&Simulation::Precision))
+            .function("getTheta", emscripten::select_overload<double() const>(&Simulation::Theta))
+            .function("setTheta", emscripten::select_overload<void(double)>(&Simulation::Theta))
+            .function("getMeshSize", emscripten::select_overload<unsigned int() const>(&Simulation::MeshSize))
+            .function("setMeshSize", emscripten::select_overload<void(unsigned int)>(&Simulation::MeshSize))
+            .function("setSimBounds", &Simulation::SetSimBounds)
+            .function("staticCount", &StaticCount)
+            .function("getStaticFieldGrid", emscripten::select_overload<unsigned int() const>(&Simulation::StaticFieldGrid))
+            .function("setStaticFieldGrid", emscripten::select_overload<void(unsigned int)>(&Simulation::StaticFieldGrid))
+            .function("getBlockTimesteps", emscripten::select_overload<bool() const>(&Simulation::BlockTimesteps))
+            .function("setBlockTimesteps", emscripten::select_overload<void(bool)>(&Simulation::BlockTimesteps))
+            .function("getMaxTimestepLevel", emscripten::select_overload<unsigned int() const>(&Simulation::MaxTimestepLevel))
+            .function("setMaxTimestepLevel", emscripten::select_overload<void(unsigned int)>(&Simulation::MaxTimestepLevel))
+            .function("getTimestepAccuracy", emscripten::select_overload<double() const>(&Simulation::TimestepAccuracy))
+            .function("setTimestepAccuracy", emscripten::select_overload<void(double)>(&Simulation::TimestepAccuracy))
+            .function("getCollisions", emscripten::select_overload<bool() const>(&Simulation::Collisions))
+            .function("setCollisions", emscripten::select_overload<void(bool)>(&Simulation::Collisions))
+            .function("mergeCount", &MergeCount)
+            .function("getCulling", emscripten::select_overload<Simulation::CullPolicy() const>(&Simulation::Culling))
+            .function("setCulling", emscripten::select_overload<void(Simulation::CullPolicy)>(&Simulation::Culling))
+            .function("takeCullEvents", &TakeCullEvents)
+            .function("getTrailLength", &GetTrailLength)
+            .function("setTrailLength", &SetTrailLength)
+            .function("getTrailInterval", emscripten::select_overload<unsigned int() const>(&Simulation::TrailInterval))
+            .function("setTrailInterval", emscripten::select_overload<void(unsigned int)>(&Simulation::TrailInterval))
+            .function("barnesHutError", &Simulation::BarnesHutError)
+            .function("getThreads", emscripten::select_overload<unsigned int() const>(&Simulation::Threads))
+            .function("setThreads", emscripten::select_overload<void(unsigned int)>(&Simulation::Threads))
             .function("getDt", emscripten::select_overload<double() const>(&Simulation::dt))
             .function("setDt", emscripten::select_overload<void(double)>(&Simulation::dt))
-            .function("centerOfMass", &Simulation::centerOfMass);
+            .function("centerOfMass", &Simulation::centerOfMass)
+            .function("energy", &Simulation::Energy)
+            .function("angularMomentum", &Simulation::AngularMomentum)
+            .function("getDiagnosticsInterval", emscripten::select_overload<unsigned int() const>(&Simulation::DiagnosticsInterval))
+            .function("setDiagnosticsInterval", emscripten::select_overload<void(unsigned int)>(&Simulation::DiagnosticsInterval))
+            .function("diagnostics", &Diagnostics)
+            .function("getStats", &Stats)
+            .function("resetStats", &ResetStats)
+            .function("reserve", &Reserve)
+            .function("reservedBodies", &ReservedBodies)
+            .function("memoryUsage", &MemoryUsage)
+            .function("addBodies", &AddBodiesFromArrays)
+            .function("saveCheckpoint", &SaveCheckpoint)
+            .function("loadCheckpoint", &LoadCheckpoint)
+            .function("save", &SaveFile)
+            .function("load", &LoadFile)
+            .function("storageGeneration", &Simulation::StorageGeneration)
+            .function("bodyIndex", &Simulation::BodyIndex)
+            .function("getReorderInterval", emscripten::select_overload<unsigned int() const>(&Simulation::ReorderInterval))
+            .function("setReorderInterval", emscripten::select_overload<void(unsigned int)>(&Simulation::ReorderInterval))
+            .function("reorderBodies", &Simulation::ReorderBodies)
+            .function("positionsX", &PositionsX)
+            .function("positionsY", &PositionsY)
+            .function("velocitiesX", &VelocitiesX)
+            .function("velocitiesY", &VelocitiesY)
+            .function("masses", &Masses)
+            .function("radii", &Radii)
+            .function("ids", &Ids)
+            .function("trails", &Trails)
+            .function("trailHead", &TrailHead);
 
     emscripten::register_vector<Body>("BodyVector");
+
+    emscripten::function("generateRing", &GenerateRing);
+    emscripten::function("generateUniformDisk", &GenerateUniformDisk);
+    emscripten::function("generatePlummer", &GeneratePlummer);
+    emscripten::function("generateAttractorField", &GenerateAttractorField);
+    emscripten::function("generateGalaxyCollision", &GenerateGalaxyCollision);
 }
 
 //    void AddBody(double mass, double radius, bool isStatic = false);
 //    void AddBody(double mass, double radius, Vector2 position, bool isStatic = false);
 //    void AddBody(double mass, double radius, Vector2 position, Vector2 velocity, Vector3 colour, bool isStatic = false);
 //    void AddBodies(std::vector<Body> bodies);
-//    double Energy() const;
-//    Vector2 AngularMomentum() const;
 //    Vector2 CalculateTotalForceOnBody(const Body& body);
\ No newline at end of file
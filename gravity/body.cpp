@@ -1,88 +1,9 @@
 ﻿#include "body.hpp"
 
-Body::Body(unsigned int id) : m_iBodyId(id), m_dMass(1.0), m_dRadius(1.0)
-{
-}
-
-Body::Body(unsigned int id, double mass, double radius) : m_iBodyId(id), m_dMass(mass), m_dRadius(radius)
-{
-}
-
-Body::Body(const Body& body) :
-        m_iBodyId(body.Id()),
-        m_dMass(body.Mass()),
-        m_dRadius(body.Radius()),
-        m_vPosition(body.Position()),
-        m_vInitialPosition(body.Position()),
-        m_vVelocity(body.Velocity()),
-        m_vInitialVelocity(body.Velocity()),
-        m_vColour(body.Colour()),
-        m_bStatic(body.Static())
-{
-}
-
-Body::~Body()
-{
-}
-
-Vector2 Body::Position() const
-{
-    return m_vPosition;
-}
-
-void Body::Position(const Vector2& rPos)
-{
-    m_vPosition = rPos;
-}
-
-Vector2 Body::InitialPosition() const
-{
-    return m_vInitialPosition;
-}
-
-void Body::InitialPosition(const Vector2& rPos)
-{
-    m_vInitialPosition = rPos;
-}
+#include "force_law.hpp"
 
-Vector2 Body::Velocity() const
+Body::Body(const BodyStore& store, std::size_t index) : m_pStore(&store), m_index(index)
 {
-    return m_vVelocity;
-}
-
-void Body::Velocity(const Vector2& rVel)
-{
-    m_vVelocity = rVel;
-}
-
-Vector2 Body::InitialVelocity() const
-{
-    return m_vInitialVelocity;
-}
-
-void Body::InitialVelocity(const Vector2& rVel)
-{
-    m_vInitialVelocity = rVel;
-}
-
-Vector2 Body::Acceleration() const
-{
-    return m_vAcceleration;
-}
-
-void Body::Acceleration(const Vector2& rAcc)
-{
-    m_vAcceleration = rAcc;
-}
-
-Vector3 Body::Colour() const
-{
-    return m_vColour;
-}
-
-void Body::Colour(const Vector3& rColour)
-{
-    m_vColour = rColour;
 }
 
 Vector2 Body::DistVectToBody(const Body& body) const
@@ -92,19 +13,19 @@ Vector2 Body::DistVectToBody(const Body& body) const
 
 double Body::GravitationalPotential(const Body& body, double G) const
 {
-    return G*body.Mass()*Mass() / DistVectToBody(body).Norm();
+    // Consistent with ForceExertedBy, see PairPotential
+    const auto distVector = DistVectToBody(body);
+    return PairPotential(distVector[0], distVector[1], body.Mass(), Mass(), G, 0.0);
 }
 
 double Body::GravitationalForce(const Body& body, double G) const
 {
-    auto normalisedDistToBody = DistVectToBody(body).Norm();
-    return (G*body.Mass()*Mass()) / (normalisedDistToBody*normalisedDistToBody);
+    return (G*body.Mass()*Mass()) / DistVectToBody(body).NormSquared();
 }
 
-double Body::GravitationalForce(Vector2& distBetweenBodies, float bodyMass, double G) const
+double Body::GravitationalForce(const Vector2& distBetweenBodies, double bodyMass, double G) const
 {
-    auto normalisedDistToBody = distBetweenBodies.Norm();
-    return (G*bodyMass*Mass()) / (normalisedDistToBody*normalisedDistToBody);
+    return (G*bodyMass*Mass()) / distBetweenBodies.NormSquared();
 }
 
 double Body::SoftenedGravitationalForce(const Body& body, double G, double softening) const
@@ -114,23 +35,16 @@ double Body::SoftenedGravitationalForce(const Body& body, double G, double softe
     return (G*body.Mass()*Mass()) / denom;
 }
 
-double Body::SoftenedGravitationalForce(Vector2& distBetweenBodies, float bodyMass, double G, double softening) const
+double Body::SoftenedGravitationalForce(const Vector2& distBetweenBodies, double bodyMass, double G, double softening) const
 {
-    auto normalisedDistToBody = distBetweenBodies.Norm();
-    // double denom = std::pow((normalisedDistToBody*normalisedDistToBody - softening*softening), 1.5);
-    double denom = normalisedDistToBody*normalisedDistToBody + softening;
-    return (G*bodyMass*Mass()) / denom;
+    return (G*bodyMass*Mass()) / (distBetweenBodies.NormSquared() + softening);
 }
 
 Vector2 Body::ForceExertedBy(const Body& body, double G, bool soften) const
 {
-    // MINIMISE CALL TO DistVectToBody - the calculation of distance takes aaaaages, so reduce this
-    auto suppliedBodyPos = body.Position();
-    auto currentBodyPos = Position();
-    auto distVector = suppliedBodyPos - currentBodyPos; // THIS LINE IS SLOOOOOOOOW
-    const auto force = soften ?
-              SoftenedGravitationalForce(distVector, body.Mass(), G, 0.01)
-            : GravitationalForce(distVector, body.Mass(), G);
-    auto forceAdd = force * (1.0 / Mass()) * distVector; // THIS LINE IS SLOOOOOOOOOW
-    return forceAdd;
+    // Acceleration of this body, F/m along the unnormalised separation with this body's mass cancelled
+    // out of F (so massless bodies work too), see force_law.hpp
+    const Vector2 distVector = body.Position() - Position();
+    const double denom = distVector.NormSquared() + (soften ? SOFTENING : 0.0);
+    return (G * body.Mass() / denom) * distVector;
 }
\ No newline at end of file
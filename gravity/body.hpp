@@ -1,72 +1,43 @@
 #pragma once
 
+#include <cstddef>
+
+#include "body_store.hpp"
 #include "vector.hpp"
 
+// Lightweight read-only view of a single body held in a BodyStore. Views are cheap to copy and always
+// read the current state from the store, they remain valid for as long as the body stays at the same index
+// (bodies move when others are added or removed or the store is reordered, Id() is what stays the same).
 class Body
 {
 public:
-    Body(unsigned int id);
-    Body(unsigned int id, double mass, double radius);
-    Body(const Body& body);
-    ~Body();
-
-    Vector2 Position() const;
-    void Position(const Vector2& rPos);
-
-    Vector2 InitialPosition() const;
-    void InitialPosition(const Vector2& rPos);
-
-    Vector2 Velocity() const;
-    void Velocity(const Vector2& rVel);
-
-    Vector2 InitialVelocity() const;
-    void InitialVelocity(const Vector2& rVel);
-
-    Vector2 Acceleration() const;
-    void Acceleration(const Vector2& rAcc);
-
-    Vector3 Colour() const;
-    void Colour(const Vector3& rColour);
-
-    unsigned int Id() const { return m_iBodyId; };
-
-    double Mass() const { return m_dMass; };
-    void Mass(double m) { m_dMass = m; };
-
-    double Radius() const { return m_dRadius; };
-    void Radius(double r) { m_dRadius = r; };
-
-    bool Static() const { return m_bStatic; };
-    void Static(bool s) { m_bStatic = s; };
+    Body(const BodyStore& store, std::size_t index);
+
+    // Positions, velocities and accelerations are separate x and y columns in the store so these are built
+    // on the fly (two loads, the vectors are plain values), the rest refer straight into the store
+    Vector2 Position() const { return Vector2(m_pStore->X[m_index], m_pStore->Y[m_index]); };
+    const Vector2& InitialPosition() const { return m_pStore->InitialPosition[m_index]; };
+    Vector2 Velocity() const { return Vector2(m_pStore->VX[m_index], m_pStore->VY[m_index]); };
+    const Vector2& InitialVelocity() const { return m_pStore->InitialVelocity[m_index]; };
+    Vector2 Acceleration() const { return Vector2(m_pStore->AX[m_index], m_pStore->AY[m_index]); };
+    const Vector3& Colour() const { return m_pStore->Colour[m_index]; };
+
+    unsigned int Id() const { return m_pStore->Id[m_index]; };
+    std::size_t Index() const { return m_index; };
+    double Mass() const { return m_pStore->Mass[m_index]; };
+    double Radius() const { return m_pStore->Radius[m_index]; };
+    bool Static() const { return m_pStore->Static[m_index] != 0; };
 
     Vector2 DistVectToBody(const Body& body) const;
 
     double GravitationalPotential(const Body& body, double G) const;
     double GravitationalForce(const Body& body, double G) const;
-    double GravitationalForce(Vector2& distBetweenBodies, float bodyMass, double G) const;
+    double GravitationalForce(const Vector2& distBetweenBodies, double bodyMass, double G) const;
     double SoftenedGravitationalForce(const Body& body, double G, double softening) const;
-    double SoftenedGravitationalForce(Vector2& distBetweenBodies, float bodyMass, double G, double softening) const;
+    double SoftenedGravitationalForce(const Vector2& distBetweenBodies, double bodyMass, double G, double softening) const;
     Vector2 ForceExertedBy(const Body& body, double G, bool soften = false) const;
 
-    void operator=(const Body& body)
-    {
-        m_dMass = body.Mass();
-        m_dRadius = body.Radius();
-        m_vPosition = body.Position();
-        m_vVelocity = body.Velocity();
-        m_vAcceleration = body.Acceleration();
-        m_bStatic = body.Static();
-    }
-
 private:
-    const unsigned int m_iBodyId;
-    double m_dMass;
-    double m_dRadius;
-    Vector2 m_vPosition;
-    Vector2 m_vInitialPosition;
-    Vector2 m_vVelocity;
-    Vector2 m_vInitialVelocity;
-    Vector2 m_vAcceleration;
-    Vector3 m_vColour;
-    bool m_bStatic;
-};
\ No newline at end of file
+    const BodyStore* m_pStore;
+    std::size_t m_index;
+};
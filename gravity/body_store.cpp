@@ -0,0 +1,301 @@
+#include "body_store.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+    // Size below which the id table is left as it is, see BodyStore::TrimIndex
+    const std::size_t MIN_INDEX_TRIM = 1024;
+
+    template<class T>
+    void Compact(std::vector<T>& column, const std::vector<unsigned char>& removed)
+    {
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < column.size(); ++i)
+        {
+            if (!removed[i])
+            {
+                column[kept++] = column[i];
+            }
+        }
+        column.resize(kept);
+    }
+
+    template<class T>
+    std::size_t CapacityBytes(const std::vector<T>& column)
+    {
+        return column.capacity() * sizeof(T);
+    }
+}
+
+void BodyStore::Reserve(std::size_t count)
+{
+    if (count <= Mass.capacity())
+    {
+        return;
+    }
+    ++m_generation;
+    X.reserve(count);
+    Y.reserve(count);
+    VX.reserve(count);
+    VY.reserve(count);
+    AX.reserve(count);
+    AY.reserve(count);
+    Mass.reserve(count);
+    TimestepLevel.reserve(count);
+    Id.reserve(count);
+    Radius.reserve(count);
+    Static.reserve(count);
+    Colour.reserve(count);
+    InitialPosition.reserve(count);
+    InitialVelocity.reserve(count);
+    m_indexOfId.reserve(count);
+}
+
+std::size_t BodyStore::MemoryBytes() const
+{
+    return CapacityBytes(X) + CapacityBytes(Y) + CapacityBytes(VX) + CapacityBytes(VY) + CapacityBytes(AX) +
+           CapacityBytes(AY) + CapacityBytes(Mass) + CapacityBytes(TimestepLevel) + CapacityBytes(Id) +
+           CapacityBytes(Radius) + CapacityBytes(Static) + CapacityBytes(Colour) + CapacityBytes(InitialPosition) +
+           CapacityBytes(InitialVelocity) + CapacityBytes(m_indexOfId);
+}
+
+void BodyStore::Clear()
+{
+    ++m_generation;
+    X.clear();
+    Y.clear();
+    VX.clear();
+    VY.clear();
+    AX.clear();
+    AY.clear();
+    Mass.clear();
+    TimestepLevel.clear();
+    Id.clear();
+    Radius.clear();
+    Static.clear();
+    Colour.clear();
+    InitialPosition.clear();
+    InitialVelocity.clear();
+    m_indexOfId.clear();
+    m_firstId = 0;
+    m_indexTrimSize = 0;
+}
+
+std::size_t BodyStore::Add(unsigned int id, double mass, double radius, const Vector2& position, const Vector2& velocity,
+                           const Vector3& colour, bool isStatic)
+{
+    ++m_generation;
+    X.push_back(position[0]);
+    Y.push_back(position[1]);
+    VX.push_back(velocity[0]);
+    VY.push_back(velocity[1]);
+    AX.push_back(0.0);
+    AY.push_back(0.0);
+    Mass.push_back(mass);
+    TimestepLevel.push_back(0);
+    Id.push_back(id);
+    Radius.push_back(radius);
+    Static.push_back(isStatic ? 1 : 0);
+    Colour.push_back(colour);
+    InitialPosition.push_back(position);
+    InitialVelocity.push_back(velocity);
+    CoverIds(id, 1);
+    IndexSlot(id) = Size() - 1;
+    return Size() - 1;
+}
+
+void BodyStore::Append(std::size_t count, unsigned int firstId, const double* mass, const double* radius,
+                       const double* x, const double* y, const double* vx, const double* vy, bool isStatic)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    ++m_generation;
+
+    const std::size_t first = Size();
+    X.insert(X.end(), x, x + count);
+    Y.insert(Y.end(), y, y + count);
+    if (vx && vy)
+    {
+        VX.insert(VX.end(), vx, vx + count);
+        VY.insert(VY.end(), vy, vy + count);
+    }
+    else
+    {
+        VX.resize(first + count, 0.0);
+        VY.resize(first + count, 0.0);
+    }
+    AX.resize(first + count, 0.0);
+    AY.resize(first + count, 0.0);
+    Mass.insert(Mass.end(), mass, mass + count);
+    TimestepLevel.resize(first + count, 0);
+    Radius.insert(Radius.end(), radius, radius + count);
+    Static.resize(first + count, isStatic ? 1 : 0);
+    Colour.resize(first + count);
+
+    Id.resize(first + count);
+    InitialPosition.resize(first + count);
+    InitialVelocity.resize(first + count);
+    CoverIds(firstId, count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        Id[first + i] = firstId + static_cast<unsigned int>(i);
+        IndexSlot(firstId + static_cast<unsigned int>(i)) = first + i;
+        InitialPosition[first + i] = Vector2(X[first + i], Y[first + i]);
+        InitialVelocity[first + i] = Vector2(VX[first + i], VY[first + i]);
+    }
+}
+
+std::size_t BodyStore::RemoveMarked(const std::vector<unsigned char>& removed)
+{
+    const std::size_t before = Size();
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < before; ++i)
+    {
+        IndexSlot(Id[i]) = removed[i] ? NO_INDEX : kept++;
+    }
+    Compact(X, removed);
+    Compact(Y, removed);
+    Compact(VX, removed);
+    Compact(VY, removed);
+    Compact(AX, removed);
+    Compact(AY, removed);
+    Compact(Mass, removed);
+    Compact(TimestepLevel, removed);
+    Compact(Id, removed);
+    Compact(Radius, removed);
+    Compact(Static, removed);
+    Compact(Colour, removed);
+    Compact(InitialPosition, removed);
+    Compact(InitialVelocity, removed);
+
+    const std::size_t count = before - Size();
+    if (count > 0)
+    {
+        ++m_generation;
+        TrimIndex();
+    }
+    return count;
+}
+
+void BodyStore::PopBack()
+{
+    ++m_generation;
+    IndexSlot(Id.back()) = NO_INDEX;
+    X.pop_back();
+    Y.pop_back();
+    VX.pop_back();
+    VY.pop_back();
+    AX.pop_back();
+    AY.pop_back();
+    Mass.pop_back();
+    TimestepLevel.pop_back();
+    Id.pop_back();
+    Radius.pop_back();
+    Static.pop_back();
+    Colour.pop_back();
+    InitialPosition.pop_back();
+    InitialVelocity.pop_back();
+    TrimIndex();
+}
+
+void BodyStore::Swap(std::size_t i, std::size_t j)
+{
+    std::swap(X[i], X[j]);
+    std::swap(Y[i], Y[j]);
+    std::swap(VX[i], VX[j]);
+    std::swap(VY[i], VY[j]);
+    std::swap(AX[i], AX[j]);
+    std::swap(AY[i], AY[j]);
+    std::swap(Mass[i], Mass[j]);
+    std::swap(TimestepLevel[i], TimestepLevel[j]);
+    std::swap(Id[i], Id[j]);
+    std::swap(Radius[i], Radius[j]);
+    std::swap(Static[i], Static[j]);
+    std::swap(Colour[i], Colour[j]);
+    std::swap(InitialPosition[i], InitialPosition[j]);
+    std::swap(InitialVelocity[i], InitialVelocity[j]);
+    IndexSlot(Id[i]) = i;
+    IndexSlot(Id[j]) = j;
+}
+
+void BodyStore::Permute(const std::vector<std::size_t>& order, std::vector<unsigned char>& scratch)
+{
+    ++m_generation;
+    PermuteColumn(X, order, scratch);
+    PermuteColumn(Y, order, scratch);
+    PermuteColumn(VX, order, scratch);
+    PermuteColumn(VY, order, scratch);
+    PermuteColumn(AX, order, scratch);
+    PermuteColumn(AY, order, scratch);
+    PermuteColumn(Mass, order, scratch);
+    PermuteColumn(TimestepLevel, order, scratch);
+    PermuteColumn(Id, order, scratch);
+    PermuteColumn(Radius, order, scratch);
+    PermuteColumn(Static, order, scratch);
+    PermuteColumn(Colour, order, scratch);
+    PermuteColumn(InitialPosition, order, scratch);
+    PermuteColumn(InitialVelocity, order, scratch);
+    for (std::size_t i = 0; i < order.size(); ++i)
+    {
+        IndexSlot(Id[i]) = i;
+    }
+}
+
+std::size_t BodyStore::IndexOf(unsigned int id) const
+{
+    return id >= m_firstId && id - m_firstId < m_indexOfId.size() ? m_indexOfId[id - m_firstId] : NO_INDEX;
+}
+
+void BodyStore::RebuildIndex()
+{
+    unsigned int minId = Empty() ? 0 : Id[0];
+    unsigned int maxId = minId;
+    for (unsigned int id : Id)
+    {
+        minId = std::min(minId, id);
+        maxId = std::max(maxId, id);
+    }
+    m_firstId = minId;
+    m_indexOfId.assign(Empty() ? 0 : static_cast<std::size_t>(maxId - minId) + 1, NO_INDEX);
+    for (std::size_t i = 0; i < Size(); ++i)
+    {
+        IndexSlot(Id[i]) = i;
+    }
+    m_indexTrimSize = m_indexOfId.size();
+}
+
+void BodyStore::CoverIds(unsigned int firstId, std::size_t count)
+{
+    if (m_indexOfId.empty())
+    {
+        m_firstId = firstId;
+    }
+    else if (firstId < m_firstId)
+    {
+        m_indexOfId.insert(m_indexOfId.begin(), m_firstId - firstId, NO_INDEX);
+        m_firstId = firstId;
+    }
+    const std::size_t end = static_cast<std::size_t>(firstId - m_firstId) + count;
+    if (m_indexOfId.size() < end)
+    {
+        m_indexOfId.resize(end, NO_INDEX);
+    }
+}
+
+void BodyStore::TrimIndex()
+{
+    // Rebuilding costs the size of the table, so waiting for it to double makes it O(1) per body added
+    if (m_indexOfId.size() <= 2 * std::max(m_indexTrimSize, MIN_INDEX_TRIM))
+    {
+        return;
+    }
+    RebuildIndex();
+    if (m_indexOfId.capacity() > 2 * std::max(m_indexOfId.size(), MIN_INDEX_TRIM))
+    {
+        m_indexOfId.shrink_to_fit();
+    }
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "vector.hpp"
+
+// Structure of arrays storage for all of the bodies in a simulation. The columns that the force and
+// integration loops touch every step are kept contiguous, per-body data that is rarely read (colour,
+// initial conditions etc.) is stored separately so it never gets pulled through the cache in the hot loops.
+// A body is addressed by its index into the columns, which changes as bodies are added, removed or reordered,
+// and identified by its id, which never changes. IndexOf maps an id to the body's current index.
+struct BodyStore
+{
+    static constexpr std::size_t NO_INDEX = static_cast<std::size_t>(-1);
+
+    std::size_t Size() const { return Mass.size(); };
+    bool Empty() const { return Mass.empty(); };
+
+    // Incremented whenever the size of the store changes or the columns may have been reallocated, any
+    // pointers into (or views over) the columns obtained before a change must be refreshed
+    unsigned int Generation() const { return m_generation; };
+
+    void Reserve(std::size_t count);
+    void Clear();
+
+    // Bytes allocated for the columns, including reserved but unused capacity
+    std::size_t MemoryBytes() const;
+
+    // Appends a body to the end of the store, returns its index
+    std::size_t Add(unsigned int id, double mass, double radius, const Vector2& position, const Vector2& velocity,
+                    const Vector3& colour, bool isStatic);
+
+    // Appends count bodies with consecutive ids starting at firstId from packed columns, growing each column
+    // once. Velocities may be null for bodies starting at rest.
+    void Append(std::size_t count, unsigned int firstId, const double* mass, const double* radius,
+                const double* x, const double* y, const double* vx, const double* vy, bool isStatic);
+
+    // Removes the bodies with a non-zero entry in removed (one per body), keeping the order of the rest.
+    // Returns the number removed.
+    std::size_t RemoveMarked(const std::vector<unsigned char>& removed);
+
+    // Removes the last body
+    void PopBack();
+
+    // Exchanges every column of bodies i and j
+    void Swap(std::size_t i, std::size_t j);
+
+    // Moves body order[i] to index i for each i < order.size(), bodies from order.size() on stay put. order
+    // must be a permutation of [0, order.size()), scratch is working space.
+    void Permute(const std::vector<std::size_t>& order, std::vector<unsigned char>& scratch);
+
+    // Current index of the body with the given id, NO_INDEX if there is none (it was removed)
+    std::size_t IndexOf(unsigned int id) const;
+    // Rebuilds the id to index map from the Id column, after the columns have been replaced wholesale
+    void RebuildIndex();
+
+    // Hot data
+    std::vector<double> X;
+    std::vector<double> Y;
+    std::vector<double> VX;
+    std::vector<double> VY;
+    std::vector<double> AX;
+    std::vector<double> AY;
+    std::vector<double> Mass;
+
+    // Block timestep level, the body steps with dt/2^level (see Simulation::BlockTimesteps)
+    std::vector<unsigned char> TimestepLevel;
+
+    // Cold data
+    std::vector<unsigned int> Id;
+    std::vector<double> Radius;
+    std::vector<unsigned char> Static;
+    std::vector<Vector3> Colour;
+    std::vector<Vector2> InitialPosition;
+    std::vector<Vector2> InitialVelocity;
+
+private:
+    std::size_t& IndexSlot(unsigned int id) { return m_indexOfId[id - m_firstId]; };
+    // Grows the id table to take in ids [firstId, firstId + count)
+    void CoverIds(unsigned int firstId, std::size_t count);
+    // Rebuilds the id table once it has doubled since it was last rebuilt, called as bodies are removed
+    void TrimIndex();
+
+    unsigned int m_generation = 0;
+    // Index of each id from m_firstId on. Ids are handed out consecutively and never reused, so this is a
+    // dense table over the ids from the oldest body's to the newest's. Removed bodies leave NO_INDEX holes and
+    // the table only grows as bodies are added, so TrimIndex cuts it back to the span of the ids still in use,
+    // which keeps it to within twice that span however many bodies have come and gone.
+    std::vector<std::size_t> m_indexOfId;
+    unsigned int m_firstId = 0;
+    std::size_t m_indexTrimSize = 0;
+};
+
+// Moves column[order[i]] to column[i] for each i < order.size(). Gathers into scratch and copies back rather
+// than following the permutation's cycles in place, which is one long chain of dependent loads.
+template<class T>
+void PermuteColumn(std::vector<T>& column, const std::vector<std::size_t>& order, std::vector<unsigned char>& scratch)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "columns are gathered as bytes");
+    const std::size_t count = order.size();
+    scratch.resize(count * sizeof(T));
+    unsigned char* gathered = scratch.data();
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        std::memcpy(gathered + i * sizeof(T), &column[order[i]], sizeof(T));
+    }
+    if (count > 0)
+    {
+        std::memcpy(column.data(), gathered, count * sizeof(T));
+    }
+}
@@ -0,0 +1,411 @@
+#include "checkpoint.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#if !defined(__EMSCRIPTEN__) && !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define GRAVITY_HAVE_MMAP
+#endif
+
+namespace
+{
+    const char MAGIC[8] = { 'G', 'R', 'A', 'V', 'C', 'K', 'P', 'T' };
+
+    // Header flags
+    const std::uint32_t FLAG_SOFTEN = 1;
+    const std::uint32_t FLAG_ACCELERATIONS = 2;
+    const std::uint32_t FLAG_JERKS = 4;
+
+    // Magic, version, header size and body count, then the CheckpointHeader fields. Version 1 ended before
+    // MaxTimestepLevel.
+    const std::size_t HEADER_SIZE_V1 = 8 + 4 + 4 + 8 + 2 * 8 + 8 * 8 + 4 + 4;
+    const std::size_t HEADER_SIZE = HEADER_SIZE_V1 + 4;
+
+    // Deepest block timestep level a body can be on, see Simulation::MaxTimestepLevel
+    const unsigned char MAX_TIMESTEP_LEVEL = 30;
+
+    // Most ids a checkpoint of bodies may have handed out per byte of the file. Loading allocates by id (the
+    // duplicate check, BodyStore's id table), so a corrupt NextId far beyond this is rejected first. Every body
+    // takes over a hundred bytes, so this still allows for tens of thousands of ids per body still alive.
+    const std::size_t MAX_IDS_PER_BYTE = 256;
+
+    bool LittleEndianHost()
+    {
+        const std::uint16_t probe = 1;
+        unsigned char first;
+        std::memcpy(&first, &probe, 1);
+        return first == 1;
+    }
+
+    std::size_t Align(std::size_t offset)
+    {
+        return (offset + 7) & ~static_cast<std::size_t>(7);
+    }
+
+    template<class T>
+    void Put(std::vector<unsigned char>& buffer, const T& value)
+    {
+        const std::size_t offset = buffer.size();
+        buffer.resize(offset + sizeof(T));
+        std::memcpy(buffer.data() + offset, &value, sizeof(T));
+    }
+
+    template<class T>
+    void PutColumn(std::vector<unsigned char>& buffer, const T* values, std::size_t count)
+    {
+        buffer.resize(Align(buffer.size()));
+        const std::size_t offset = buffer.size();
+        buffer.resize(offset + count * sizeof(T));
+        if (count > 0)
+        {
+            std::memcpy(buffer.data() + offset, values, count * sizeof(T));
+        }
+    }
+
+    // Component of a column of vectors, written as its own packed column
+    template<class VECTOR>
+    void PutComponent(std::vector<unsigned char>& buffer, const std::vector<VECTOR>& values, unsigned int component)
+    {
+        buffer.resize(Align(buffer.size()));
+        for (const VECTOR& value : values)
+        {
+            Put(buffer, value[component]);
+        }
+    }
+
+    // Bounds checked reads over the checkpoint data
+    class Reader
+    {
+    public:
+        Reader(const unsigned char* data, std::size_t size) : m_data(data), m_size(size), m_offset(0) {}
+
+        std::size_t Offset() const { return m_offset; }
+        void Seek(std::size_t offset) { m_offset = offset; }
+
+        template<class T>
+        bool Get(T& value)
+        {
+            if (m_offset > m_size || m_size - m_offset < sizeof(T))
+            {
+                return false;
+            }
+            std::memcpy(&value, m_data + m_offset, sizeof(T));
+            m_offset += sizeof(T);
+            return true;
+        }
+
+        template<class T>
+        bool GetColumn(std::vector<T>& values, std::size_t count)
+        {
+            m_offset = Align(m_offset);
+            if (m_offset > m_size || (m_size - m_offset) / sizeof(T) < count)
+            {
+                return false;
+            }
+            values.resize(count);
+            if (count > 0)
+            {
+                std::memcpy(values.data(), m_data + m_offset, count * sizeof(T));
+            }
+            m_offset += count * sizeof(T);
+            return true;
+        }
+
+        template<class VECTOR>
+        bool GetComponent(std::vector<VECTOR>& values, unsigned int component)
+        {
+            m_offset = Align(m_offset);
+            if (m_offset > m_size || (m_size - m_offset) / sizeof(double) < values.size())
+            {
+                return false;
+            }
+            for (VECTOR& value : values)
+            {
+                std::memcpy(&value[component], m_data + m_offset, sizeof(double));
+                m_offset += sizeof(double);
+            }
+            return true;
+        }
+
+    private:
+        const unsigned char* m_data;
+        std::size_t m_size;
+        std::size_t m_offset;
+    };
+}
+
+void WriteCheckpoint(const CheckpointHeader& header, const BodyStore& bodies, const std::vector<double>& jerkX,
+                     const std::vector<double>& jerkY, std::vector<unsigned char>& buffer)
+{
+    const std::size_t count = bodies.Size();
+    const bool jerks = header.AccelerationsValid && jerkX.size() == count && jerkY.size() == count;
+    std::uint32_t flags = 0;
+    flags |= header.Soften ? FLAG_SOFTEN : 0;
+    flags |= header.AccelerationsValid ? FLAG_ACCELERATIONS : 0;
+    flags |= jerks ? FLAG_JERKS : 0;
+    buffer.clear();
+    buffer.reserve(HEADER_SIZE + count * (17 * sizeof(double) + sizeof(unsigned int) + 2) + 20 * 8);
+
+    buffer.insert(buffer.end(), MAGIC, MAGIC + sizeof(MAGIC));
+    Put(buffer, CHECKPOINT_VERSION);
+    Put(buffer, static_cast<std::uint32_t>(HEADER_SIZE));
+    Put(buffer, static_cast<std::uint64_t>(count));
+    Put(buffer, header.StepCount);
+    Put(buffer, header.MergeCount);
+    Put(buffer, header.Time);
+    Put(buffer, header.PendingTime);
+    Put(buffer, header.G);
+    Put(buffer, header.Dt);
+    Put(buffer, header.BoundsMinX);
+    Put(buffer, header.BoundsMaxX);
+    Put(buffer, header.BoundsMinY);
+    Put(buffer, header.BoundsMaxY);
+    Put(buffer, header.NextId);
+    Put(buffer, flags);
+    Put(buffer, header.MaxTimestepLevel);
+
+    PutColumn(buffer, bodies.X.data(), count);
+    PutColumn(buffer, bodies.Y.data(), count);
+    PutColumn(buffer, bodies.VX.data(), count);
+    PutColumn(buffer, bodies.VY.data(), count);
+    PutColumn(buffer, bodies.AX.data(), count);
+    PutColumn(buffer, bodies.AY.data(), count);
+    PutColumn(buffer, bodies.Mass.data(), count);
+    PutColumn(buffer, bodies.Radius.data(), count);
+    PutColumn(buffer, bodies.Id.data(), count);
+    PutColumn(buffer, bodies.Static.data(), count);
+    PutColumn(buffer, bodies.TimestepLevel.data(), count);
+    for (unsigned int c = 0; c < 3; ++c)
+    {
+        PutComponent(buffer, bodies.Colour, c);
+    }
+    for (unsigned int c = 0; c < 2; ++c)
+    {
+        PutComponent(buffer, bodies.InitialPosition, c);
+    }
+    for (unsigned int c = 0; c < 2; ++c)
+    {
+        PutComponent(buffer, bodies.InitialVelocity, c);
+    }
+    if (jerks)
+    {
+        PutColumn(buffer, jerkX.data(), count);
+        PutColumn(buffer, jerkY.data(), count);
+    }
+}
+
+bool ReadCheckpoint(const unsigned char* data, std::size_t size, CheckpointHeader& header, BodyStore& bodies,
+                    std::vector<double>& jerkX, std::vector<double>& jerkY, std::string& error)
+{
+    if (!LittleEndianHost())
+    {
+        error = "Checkpoints can only be read on little-endian hosts";
+        return false;
+    }
+    if (size < HEADER_SIZE_V1 || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        error = "Not a gravity checkpoint";
+        return false;
+    }
+
+    Reader reader(data, size);
+    reader.Seek(sizeof(MAGIC));
+    std::uint32_t version = 0;
+    std::uint32_t headerSize = 0;
+    std::uint64_t count = 0;
+    reader.Get(version);
+    reader.Get(headerSize);
+    reader.Get(count);
+    if (version == 0 || version > CHECKPOINT_VERSION)
+    {
+        error = "Unsupported checkpoint version " + std::to_string(version);
+        return false;
+    }
+    if (headerSize < (version == 1 ? HEADER_SIZE_V1 : HEADER_SIZE) || headerSize > size)
+    {
+        error = "Corrupt checkpoint header";
+        return false;
+    }
+
+    CheckpointHeader read;
+    std::uint32_t flags = 0;
+    reader.Get(read.StepCount);
+    reader.Get(read.MergeCount);
+    reader.Get(read.Time);
+    reader.Get(read.PendingTime);
+    reader.Get(read.G);
+    reader.Get(read.Dt);
+    reader.Get(read.BoundsMinX);
+    reader.Get(read.BoundsMaxX);
+    reader.Get(read.BoundsMinY);
+    reader.Get(read.BoundsMaxY);
+    reader.Get(read.NextId);
+    reader.Get(flags);
+    // Not known for version 1, where 0 makes no claim about the levels
+    read.MaxTimestepLevel = 0;
+    if (version >= 2)
+    {
+        reader.Get(read.MaxTimestepLevel);
+    }
+    read.Soften = (flags & FLAG_SOFTEN) != 0;
+    read.AccelerationsValid = (flags & FLAG_ACCELERATIONS) != 0;
+
+    // Columns are read into a new store so a truncated file leaves the simulation as it was
+    BodyStore store;
+    const std::size_t bodyCount = static_cast<std::size_t>(count);
+    reader.Seek(headerSize);
+    bool ok = reader.GetColumn(store.X, bodyCount) &&
+              reader.GetColumn(store.Y, bodyCount) &&
+              reader.GetColumn(store.VX, bodyCount) &&
+              reader.GetColumn(store.VY, bodyCount) &&
+              reader.GetColumn(store.AX, bodyCount) &&
+              reader.GetColumn(store.AY, bodyCount) &&
+              reader.GetColumn(store.Mass, bodyCount) &&
+              reader.GetColumn(store.Radius, bodyCount) &&
+              reader.GetColumn(store.Id, bodyCount) &&
+              reader.GetColumn(store.Static, bodyCount) &&
+              reader.GetColumn(store.TimestepLevel, bodyCount);
+    if (ok)
+    {
+        store.Colour.resize(bodyCount);
+        store.InitialPosition.resize(bodyCount);
+        store.InitialVelocity.resize(bodyCount);
+        for (unsigned int c = 0; c < 3 && ok; ++c)
+        {
+            ok = reader.GetComponent(store.Colour, c);
+        }
+        for (unsigned int c = 0; c < 2 && ok; ++c)
+        {
+            ok = reader.GetComponent(store.InitialPosition, c);
+        }
+        for (unsigned int c = 0; c < 2 && ok; ++c)
+        {
+            ok = reader.GetComponent(store.InitialVelocity, c);
+        }
+    }
+    std::vector<double> readJerkX;
+    std::vector<double> readJerkY;
+    if (ok && (flags & FLAG_JERKS))
+    {
+        ok = reader.GetColumn(readJerkX, bodyCount) && reader.GetColumn(readJerkY, bodyCount);
+    }
+    if (!ok)
+    {
+        error = "Checkpoint is truncated";
+        return false;
+    }
+
+    if (read.MaxTimestepLevel > MAX_TIMESTEP_LEVEL)
+    {
+        error = "Corrupt checkpoint timestep level " + std::to_string(read.MaxTimestepLevel);
+        return false;
+    }
+    for (const unsigned char level : store.TimestepLevel)
+    {
+        if (level > MAX_TIMESTEP_LEVEL)
+        {
+            error = "Corrupt checkpoint timestep level " + std::to_string(level);
+            return false;
+        }
+    }
+
+    // Ids must be below NextId (so new bodies don't reuse them) and distinct
+    if (bodyCount > 0)
+    {
+        if (read.NextId < bodyCount || read.NextId / MAX_IDS_PER_BYTE > size)
+        {
+            error = "Corrupt checkpoint next id " + std::to_string(read.NextId);
+            return false;
+        }
+        std::vector<unsigned char> seen((read.NextId + 7) / 8, 0);
+        for (const unsigned int id : store.Id)
+        {
+            const unsigned char bit = static_cast<unsigned char>(1u << (id % 8));
+            if (id >= read.NextId || (seen[id / 8] & bit) != 0)
+            {
+                error = "Corrupt checkpoint body id " + std::to_string(id);
+                return false;
+            }
+            seen[id / 8] |= bit;
+        }
+    }
+
+    bodies.Clear();
+    bodies.X.swap(store.X);
+    bodies.Y.swap(store.Y);
+    bodies.VX.swap(store.VX);
+    bodies.VY.swap(store.VY);
+    bodies.AX.swap(store.AX);
+    bodies.AY.swap(store.AY);
+    bodies.Mass.swap(store.Mass);
+    bodies.TimestepLevel.swap(store.TimestepLevel);
+    bodies.Id.swap(store.Id);
+    bodies.Radius.swap(store.Radius);
+    bodies.Static.swap(store.Static);
+    bodies.Colour.swap(store.Colour);
+    bodies.InitialPosition.swap(store.InitialPosition);
+    bodies.InitialVelocity.swap(store.InitialVelocity);
+    bodies.RebuildIndex();
+    jerkX.swap(readJerkX);
+    jerkY.swap(readJerkY);
+    header = read;
+    return true;
+}
+
+bool WriteCheckpointFile(const std::string& path, const std::vector<unsigned char>& buffer, std::string& error)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file || !file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size()))
+    {
+        error = "Couldn't write checkpoint " + path;
+        return false;
+    }
+    return true;
+}
+
+bool ReadCheckpointFile(const std::string& path, CheckpointHeader& header, BodyStore& bodies,
+                        std::vector<double>& jerkX, std::vector<double>& jerkY, std::string& error)
+{
+#if defined(GRAVITY_HAVE_MMAP)
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        error = "Couldn't open checkpoint " + path;
+        return false;
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size <= 0)
+    {
+        ::close(fd);
+        error = "Couldn't read checkpoint " + path;
+        return false;
+    }
+    const std::size_t size = static_cast<std::size_t>(info.st_size);
+    void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        error = "Couldn't map checkpoint " + path;
+        return false;
+    }
+    // The columns are read front to back exactly once
+    ::madvise(mapped, size, MADV_SEQUENTIAL);
+    const bool ok = ReadCheckpoint(static_cast<const unsigned char*>(mapped), size, header, bodies, jerkX, jerkY, error);
+    ::munmap(mapped, size);
+    return ok;
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        error = "Couldn't open checkpoint " + path;
+        return false;
+    }
+    const std::vector<unsigned char> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return ReadCheckpoint(buffer.data(), buffer.size(), header, bodies, jerkX, jerkY, error);
+#endif
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "body_store.hpp"
+
+// Binary checkpoint format, little-endian throughout:
+//   header    magic "GRAVCKPT", version, header size, then the simulation scalars below
+//   columns   one packed array per body column (see checkpoint.cpp for the order), each starting on an
+//             8 byte boundary so a mapped file can be read column by column. The accelerations (and the
+//             Hermite jerks, if any) carried over to the next step are stored too, so a restarted run
+//             continues bit for bit the same as one that was never stopped.
+// Readers accept any version up to CHECKPOINT_VERSION and skip header fields they don't know about.
+static const std::uint32_t CHECKPOINT_VERSION = 2;
+
+struct CheckpointHeader
+{
+    std::uint64_t StepCount;
+    std::uint64_t MergeCount;
+    double Time;
+    double PendingTime;
+    double G;
+    double Dt;
+    double BoundsMinX;
+    double BoundsMaxX;
+    double BoundsMinY;
+    double BoundsMaxY;
+    std::uint32_t NextId;
+    // Simulation::MaxTimestepLevel the body timestep levels were picked under, 0 if not recorded
+    std::uint32_t MaxTimestepLevel;
+    bool Soften;
+    bool AccelerationsValid;
+};
+
+// Serialises the header and bodies into buffer, replacing its contents. The jerks are only written if
+// they have an entry per body.
+void WriteCheckpoint(const CheckpointHeader& header, const BodyStore& bodies, const std::vector<double>& jerkX,
+                     const std::vector<double>& jerkY, std::vector<unsigned char>& buffer);
+
+// Restores the header, bodies and jerks (empty if the checkpoint has none) from a checkpoint in memory,
+// e.g. a mapped file. Returns false and sets error if the data isn't a checkpoint this build can read, in
+// which case nothing is modified.
+bool ReadCheckpoint(const unsigned char* data, std::size_t size, CheckpointHeader& header, BodyStore& bodies,
+                    std::vector<double>& jerkX, std::vector<double>& jerkY, std::string& error);
+
+// File helpers. Natively the file is memory-mapped, so loading is a copy of each column out of the page
+// cache rather than a parse. In wasm builds it is read through the Emscripten file system.
+bool WriteCheckpointFile(const std::string& path, const std::vector<unsigned char>& buffer, std::string& error);
+bool ReadCheckpointFile(const std::string& path, CheckpointHeader& header, BodyStore& bodies,
+                        std::vector<double>& jerkX, std::vector<double>& jerkY, std::string& error);
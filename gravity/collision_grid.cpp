@@ -0,0 +1,191 @@
+#include "collision_grid.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Fraction of the bodies that must fit in a cell, the rest are treated as large
+    const double SMALL_FRACTION = 0.99;
+}
+
+CollisionGrid::CollisionGrid() :
+        m_cellSize(1.0),
+        m_smallRadius(0.5),
+        m_minX(0.0),
+        m_minY(0.0),
+        m_mask(0),
+        m_visitStamp(0)
+{
+}
+
+std::size_t CollisionGrid::Bucket(long long cellX, long long cellY) const
+{
+    const unsigned long long h = static_cast<unsigned long long>(cellX) * 73856093ull ^
+                                 static_cast<unsigned long long>(cellY) * 19349663ull;
+    return static_cast<std::size_t>(h) & m_mask;
+}
+
+void CollisionGrid::TestPair(std::size_t i, std::size_t j, const double* x, const double* y, const double* radius,
+                             std::vector<std::pair<std::size_t, std::size_t>>& contacts)
+{
+    const double dx = x[j] - x[i];
+    const double dy = y[j] - y[i];
+    const double reach = radius[i] + radius[j];
+    if (dx*dx + dy*dy < reach * reach)
+    {
+        contacts.emplace_back(std::min(i, j), std::max(i, j));
+    }
+}
+
+void CollisionGrid::Visit(std::size_t i, long long cellX, long long cellY, long long reach, const double* x,
+                          const double* y, const double* radius, std::vector<std::pair<std::size_t, std::size_t>>& contacts)
+{
+    // Neighbouring cells can share a bucket, the stamp makes sure each body is only tested once
+    ++m_visitStamp;
+    const bool large = radius[i] > m_smallRadius;
+    for (long long cy = cellY - reach; cy <= cellY + reach; ++cy)
+    {
+        for (long long cx = cellX - reach; cx <= cellX + reach; ++cx)
+        {
+            const std::size_t bucket = Bucket(cx, cy);
+            for (std::size_t k = m_bucketStart[bucket]; k < m_bucketStart[bucket + 1]; ++k)
+            {
+                const std::size_t j = m_sorted[k];
+                if (j == i || m_visited[j] == m_visitStamp || m_cellX[j] != cx || m_cellY[j] != cy)
+                {
+                    continue;
+                }
+                m_visited[j] = m_visitStamp;
+
+                // Pairs of small bodies are reported by the lower index, small/large pairs by the large body
+                // and pairs of large bodies are tested separately
+                const bool otherLarge = radius[j] > m_smallRadius;
+                if (otherLarge || (!large && j < i))
+                {
+                    continue;
+                }
+                TestPair(i, j, x, y, radius, contacts);
+            }
+        }
+    }
+}
+
+void CollisionGrid::Reserve(std::size_t count)
+{
+    std::size_t buckets = 1;
+    while (buckets < 2 * count)
+    {
+        buckets <<= 1;
+    }
+    m_radii.reserve(count);
+    m_large.reserve(count - static_cast<std::size_t>(SMALL_FRACTION * count) + 1);
+    m_bucketStart.reserve(buckets + 1);
+    m_next.reserve(buckets);
+    m_sorted.reserve(count);
+    m_cellX.reserve(count);
+    m_cellY.reserve(count);
+    m_visited.reserve(count);
+}
+
+std::size_t CollisionGrid::MemoryBytes() const
+{
+    return m_radii.capacity() * sizeof(double) +
+           (m_bucketStart.capacity() + m_next.capacity() + m_sorted.capacity() + m_large.capacity()) * sizeof(std::size_t) +
+           (m_cellX.capacity() + m_cellY.capacity()) * sizeof(long long) +
+           m_visited.capacity() * sizeof(unsigned int);
+}
+
+void CollisionGrid::FindContacts(const double* x, const double* y, const double* radius, std::size_t count,
+                                 std::vector<std::pair<std::size_t, std::size_t>>& contacts)
+{
+    contacts.clear();
+    if (count < 2)
+    {
+        return;
+    }
+
+    // Cell size from the radius that nearly all of the bodies are within, so a handful of very large
+    // bodies don't make the cells so big that everything lands in the same one
+    m_radii.assign(radius, radius + count);
+    const std::size_t smallIndex = std::min(count - 1, static_cast<std::size_t>(SMALL_FRACTION * count));
+    std::nth_element(m_radii.begin(), m_radii.begin() + smallIndex, m_radii.end());
+    m_smallRadius = m_radii[smallIndex];
+    m_cellSize = m_smallRadius > 0.0 ? 2.0 * m_smallRadius : 1.0;
+
+    m_minX = x[0];
+    m_minY = y[0];
+    for (std::size_t i = 1; i < count; ++i)
+    {
+        m_minX = std::min(m_minX, x[i]);
+        m_minY = std::min(m_minY, y[i]);
+    }
+
+    std::size_t buckets = 1;
+    while (buckets < 2 * count)
+    {
+        buckets <<= 1;
+    }
+    m_mask = buckets - 1;
+
+    // Counting sort of the bodies by bucket
+    m_cellX.resize(count);
+    m_cellY.resize(count);
+    m_bucketStart.assign(buckets + 1, 0);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        m_cellX[i] = static_cast<long long>(std::floor((x[i] - m_minX) / m_cellSize));
+        m_cellY[i] = static_cast<long long>(std::floor((y[i] - m_minY) / m_cellSize));
+        ++m_bucketStart[Bucket(m_cellX[i], m_cellY[i]) + 1];
+    }
+    for (std::size_t b = 0; b < buckets; ++b)
+    {
+        m_bucketStart[b + 1] += m_bucketStart[b];
+    }
+    m_sorted.resize(count);
+    m_next.assign(m_bucketStart.begin(), m_bucketStart.end() - 1);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        m_sorted[m_next[Bucket(m_cellX[i], m_cellY[i])]++] = i;
+    }
+
+    m_visited.assign(count, 0);
+    m_visitStamp = 0;
+    m_large.clear();
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (radius[i] <= m_smallRadius)
+        {
+            Visit(i, m_cellX[i], m_cellY[i], 1, x, y, radius, contacts);
+            continue;
+        }
+
+        // Large bodies search as far as any small body could touch them, or test everything if that would
+        // cover more cells than there are bodies
+        m_large.push_back(i);
+        const long long reach = static_cast<long long>(std::ceil((radius[i] + m_smallRadius) / m_cellSize));
+        const double cells = static_cast<double>(2 * reach + 1) * static_cast<double>(2 * reach + 1);
+        if (cells < static_cast<double>(count))
+        {
+            Visit(i, m_cellX[i], m_cellY[i], reach, x, y, radius, contacts);
+        }
+        else
+        {
+            for (std::size_t j = 0; j < count; ++j)
+            {
+                if (radius[j] <= m_smallRadius)
+                {
+                    TestPair(i, j, x, y, radius, contacts);
+                }
+            }
+        }
+    }
+
+    for (std::size_t a = 0; a < m_large.size(); ++a)
+    {
+        for (std::size_t b = a + 1; b < m_large.size(); ++b)
+        {
+            TestPair(m_large[a], m_large[b], x, y, radius, contacts);
+        }
+    }
+}
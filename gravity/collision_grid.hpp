@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Uniform grid broadphase for finding overlapping bodies, rebuilt from scratch from the body positions each
+// time it is used. Bodies are binned by a spatial hash of the cell containing their centre, with cells as
+// wide as the diameter of the largest typical body, so two such bodies can only overlap if they are in the
+// same or neighbouring cells. The few bodies larger than that search the cells their own radius covers.
+// Expected O(N) for bodies of similar size.
+class CollisionGrid
+{
+public:
+    CollisionGrid();
+
+    // Overwrites contacts with every pair (i, j), i < j, of bodies whose discs overlap
+    void FindContacts(const double* x, const double* y, const double* radius, std::size_t count,
+                      std::vector<std::pair<std::size_t, std::size_t>>& contacts);
+
+    // Sizes the per body arrays for count bodies so searches up to that size don't reallocate
+    void Reserve(std::size_t count);
+    std::size_t MemoryBytes() const;
+
+private:
+    std::size_t Bucket(long long cellX, long long cellY) const;
+    void TestPair(std::size_t i, std::size_t j, const double* x, const double* y, const double* radius,
+                  std::vector<std::pair<std::size_t, std::size_t>>& contacts);
+    void Visit(std::size_t i, long long cellX, long long cellY, long long reach, const double* x, const double* y,
+               const double* radius, std::vector<std::pair<std::size_t, std::size_t>>& contacts);
+
+    double m_cellSize;
+    double m_smallRadius;               // Bodies above this search beyond their neighbouring cells
+    double m_minX;
+    double m_minY;
+    std::size_t m_mask;                 // Bucket count - 1, the bucket count is a power of two
+    std::vector<double> m_radii;        // Scratch for picking the cell size
+    std::vector<std::size_t> m_bucketStart;
+    std::vector<std::size_t> m_next;    // Scratch for the counting sort
+    std::vector<std::size_t> m_sorted;  // Body indices ordered by bucket
+    std::vector<long long> m_cellX;
+    std::vector<long long> m_cellY;
+    std::vector<std::size_t> m_large;
+    std::vector<unsigned int> m_visited;
+    unsigned int m_visitStamp;
+};
@@ -0,0 +1,209 @@
+#include "force_kernel.hpp"
+
+#include "force_kernel_simd.hpp"
+
+#include <cmath>
+
+#if defined(GRAVITY_HAVE_AVX2_KERNEL)
+void DirectSumAccelerationsAvx2(const double* x, const double* y, const double* mass, std::size_t count,
+                                double G, double eps, double* ax, double* ay, double* potential);
+void DirectSumAccelerationsRangeAvx2(const double* x, const double* y, const double* mass, std::size_t count,
+                                     std::size_t begin, std::size_t end, double G, double eps, double* ax, double* ay,
+                                     double* potential);
+void DirectSumAccelerationsFloatAvx2(const float* x, const float* y, const float* mass, std::size_t count,
+                                     float G, float eps, float* ax, float* ay, double* potential);
+void DirectSumAccelerationsRangeFloatAvx2(const float* x, const float* y, const float* mass, std::size_t count,
+                                          std::size_t begin, std::size_t end, float G, float eps, float* ax, float* ay,
+                                          double* potential);
+void DirectSumAccelerationsTargetsAvx2(const double* x, const double* y, const double* mass, std::size_t count,
+                                       const std::size_t* targets, std::size_t targetCount, double G, double eps,
+                                       double* ax, double* ay);
+#endif
+
+namespace
+{
+    bool CpuSupportsAvx2()
+    {
+#if defined(GRAVITY_HAVE_AVX2_KERNEL) && (defined(__GNUC__) || defined(__clang__))
+        static const bool supported = __builtin_cpu_supports("avx2");
+        return supported;
+#else
+        return false;
+#endif
+    }
+}
+
+void DirectSumAccelerations(const double* x, const double* y, const double* mass, std::size_t count,
+                            double G, double eps, double* ax, double* ay, double* potential)
+{
+#if defined(GRAVITY_HAVE_AVX2_KERNEL)
+    if (CpuSupportsAvx2())
+    {
+        DirectSumAccelerationsAvx2(x, y, mass, count, G, eps, ax, ay, potential);
+        return;
+    }
+#endif
+
+#if defined(__wasm_simd128__)
+    RunSymmetricDirectSum<WasmSimd128Lanes>(x, y, mass, count, G, eps, ax, ay, potential);
+#elif defined(__SSE2__) || defined(_M_X64)
+    RunSymmetricDirectSum<Sse2Lanes>(x, y, mass, count, G, eps, ax, ay, potential);
+#else
+    RunSymmetricDirectSum<ScalarLanes>(x, y, mass, count, G, eps, ax, ay, potential);
+#endif
+}
+
+void DirectSumAccelerationsRange(const double* x, const double* y, const double* mass, std::size_t count,
+                                 std::size_t begin, std::size_t end, double G, double eps, double* ax, double* ay,
+                                 double* potential)
+{
+#if defined(GRAVITY_HAVE_AVX2_KERNEL)
+    if (CpuSupportsAvx2())
+    {
+        DirectSumAccelerationsRangeAvx2(x, y, mass, count, begin, end, G, eps, ax, ay, potential);
+        return;
+    }
+#endif
+
+#if defined(__wasm_simd128__)
+    RunTargetDirectSum<WasmSimd128Lanes>(x, y, mass, count, begin, end, G, eps, ax, ay, potential);
+#elif defined(__SSE2__) || defined(_M_X64)
+    RunTargetDirectSum<Sse2Lanes>(x, y, mass, count, begin, end, G, eps, ax, ay, potential);
+#else
+    RunTargetDirectSum<ScalarLanes>(x, y, mass, count, begin, end, G, eps, ax, ay, potential);
+#endif
+}
+
+void DirectSumAccelerationsFloat(const float* x, const float* y, const float* mass, std::size_t count,
+                                 float G, float eps, float* ax, float* ay, double* potential)
+{
+#if defined(GRAVITY_HAVE_AVX2_KERNEL)
+    if (CpuSupportsAvx2())
+    {
+        DirectSumAccelerationsFloatAvx2(x, y, mass, count, G, eps, ax, ay, potential);
+        return;
+    }
+#endif
+
+#if defined(__wasm_simd128__)
+    RunSymmetricDirectSum<WasmSimd128FloatLanes>(x, y, mass, count, G, eps, ax, ay, potential);
+#elif defined(__SSE2__) || defined(_M_X64)
+    RunSymmetricDirectSum<Sse2FloatLanes>(x, y, mass, count, G, eps, ax, ay, potential);
+#else
+    RunSymmetricDirectSum<ScalarFloatLanes>(x, y, mass, count, G, eps, ax, ay, potential);
+#endif
+}
+
+void DirectSumAccelerationsRangeFloat(const float* x, const float* y, const float* mass, std::size_t count,
+                                      std::size_t begin, std::size_t end, float G, float eps, float* ax, float* ay,
+                                      double* potential)
+{
+#if defined(GRAVITY_HAVE_AVX2_KERNEL)
+    if (CpuSupportsAvx2())
+    {
+        DirectSumAccelerationsRangeFloatAvx2(x, y, mass, count, begin, end, G, eps, ax, ay, potential);
+        return;
+    }
+#endif
+
+#if defined(__wasm_simd128__)
+    RunTargetDirectSum<WasmSimd128FloatLanes>(x, y, mass, count, begin, end, G, eps, ax, ay, potential);
+#elif defined(__SSE2__) || defined(_M_X64)
+    RunTargetDirectSum<Sse2FloatLanes>(x, y, mass, count, begin, end, G, eps, ax, ay, potential);
+#else
+    RunTargetDirectSum<ScalarFloatLanes>(x, y, mass, count, begin, end, G, eps, ax, ay, potential);
+#endif
+}
+
+void DirectSumAccelerationsTargets(const double* x, const double* y, const double* mass, std::size_t count,
+                                   const std::size_t* targets, std::size_t targetCount, double G, double eps,
+                                   double* ax, double* ay)
+{
+#if defined(GRAVITY_HAVE_AVX2_KERNEL)
+    if (CpuSupportsAvx2())
+    {
+        DirectSumAccelerationsTargetsAvx2(x, y, mass, count, targets, targetCount, G, eps, ax, ay);
+        return;
+    }
+#endif
+
+#if defined(__wasm_simd128__)
+    GatherDirectSum<WasmSimd128Lanes>(x, y, mass, count, targets, targetCount, G, eps, ax, ay);
+#elif defined(__SSE2__) || defined(_M_X64)
+    GatherDirectSum<Sse2Lanes>(x, y, mass, count, targets, targetCount, G, eps, ax, ay);
+#else
+    GatherDirectSum<ScalarLanes>(x, y, mass, count, targets, targetCount, G, eps, ax, ay);
+#endif
+}
+
+void DirectSumAccelerationsJerksRange(const double* x, const double* y, const double* vx, const double* vy,
+                                      const double* mass, std::size_t count, std::size_t begin, std::size_t end,
+                                      double G, double eps, double* ax, double* ay, double* jx, double* jy,
+                                      double* potential)
+{
+    // a = G*m*d/s and da/dt = G*m*(u/s - 2*d*(d.u)/s^2), with s = r^2 + eps and d, u the relative position
+    // and velocity of the source
+    double totalPotential = 0.0;
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        double axi = 0.0;
+        double ayi = 0.0;
+        double jxi = 0.0;
+        double jyi = 0.0;
+        double poti = 0.0;
+        for (std::size_t j = 0; j < count; ++j)
+        {
+            if (j == i)
+            {
+                continue;
+            }
+            const double dx = x[j] - x[i];
+            const double dy = y[j] - y[i];
+            const double ux = vx[j] - vx[i];
+            const double uy = vy[j] - vy[i];
+            const double s = dx*dx + dy*dy + eps;
+            const double scale = G * mass[j] / s;
+            const double rate = 2.0 * (dx*ux + dy*uy) / s;
+            axi += scale * dx;
+            ayi += scale * dy;
+            jxi += scale * (ux - rate * dx);
+            jyi += scale * (uy - rate * dy);
+            if (potential)
+            {
+                poti += mass[j] * std::log(s);
+            }
+        }
+        ax[i] = axi;
+        ay[i] = ayi;
+        jx[i] = jxi;
+        jy[i] = jyi;
+        // Every pair is seen from both ends, so each end carries half of the pair potential
+        totalPotential += 0.25 * G * mass[i] * poti;
+    }
+
+    if (potential)
+    {
+        *potential = totalPotential;
+    }
+}
+
+void DirectSumAccelerationsScalar(const double* x, const double* y, const double* mass, std::size_t count,
+                                  double G, double eps, double* ax, double* ay, double* potential)
+{
+    RunSymmetricDirectSum<ScalarLanes>(x, y, mass, count, G, eps, ax, ay, potential);
+}
+
+const char* DirectSumKernelName()
+{
+    if (CpuSupportsAvx2())
+    {
+        return "avx2";
+    }
+#if defined(__wasm_simd128__)
+    return "simd128";
+#elif defined(__SSE2__) || defined(_M_X64)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+
+// Direct summation of the accelerations of count bodies on each other (O(N^2)), overwriting ax/ay.
+// Each pair is evaluated once and applied to both bodies (Newton's third law). Dispatches to the widest
+// SIMD kernel available: AVX2 (checked at runtime) or SSE2 natively, simd128 in wasm builds.
+// If potential is not null the total potential energy of the bodies (see PairPotential) is written to it.
+void DirectSumAccelerations(const double* x, const double* y, const double* mass, std::size_t count,
+                            double G, double eps, double* ax, double* ay, double* potential = nullptr);
+
+// Direct summation of the accelerations on the targets [begin, end) due to all count bodies, overwriting
+// ax/ay for those targets only. Does the full N^2 pair work but lets disjoint target ranges be computed
+// concurrently. Uses the same SIMD dispatch as DirectSumAccelerations. If potential is not null the targets'
+// share of the potential energy is written to it, the shares of all ranges sum to the total.
+void DirectSumAccelerationsRange(const double* x, const double* y, const double* mass, std::size_t count,
+                                 std::size_t begin, std::size_t end, double G, double eps, double* ax, double* ay,
+                                 double* potential = nullptr);
+
+// Single precision versions of DirectSumAccelerations and DirectSumAccelerationsRange for the mixed
+// precision mode, with twice as many lanes per instruction. The potential is still summed in double.
+void DirectSumAccelerationsFloat(const float* x, const float* y, const float* mass, std::size_t count,
+                                 float G, float eps, float* ax, float* ay, double* potential = nullptr);
+void DirectSumAccelerationsRangeFloat(const float* x, const float* y, const float* mass, std::size_t count,
+                                      std::size_t begin, std::size_t end, float G, float eps, float* ax, float* ay,
+                                      double* potential = nullptr);
+
+// Direct summation of the accelerations on the bodies listed in targets due to all count bodies, written
+// packed (ax[k], ay[k] is the acceleration of body targets[k]). Used when only some of the bodies need their
+// forces recomputing, e.g. with block timesteps. Uses the same SIMD dispatch as DirectSumAccelerations.
+void DirectSumAccelerationsTargets(const double* x, const double* y, const double* mass, std::size_t count,
+                                   const std::size_t* targets, std::size_t targetCount, double G, double eps,
+                                   double* ax, double* ay);
+
+// Direct summation of the accelerations and their time derivatives (jerks) on the targets [begin, end) due
+// to all count bodies, overwriting ax/ay/jx/jy for those targets only. For the Hermite integrator, scalar.
+// If potential is not null the targets' share of the potential energy is written to it.
+void DirectSumAccelerationsJerksRange(const double* x, const double* y, const double* vx, const double* vy,
+                                      const double* mass, std::size_t count, std::size_t begin, std::size_t end,
+                                      double G, double eps, double* ax, double* ay, double* jx, double* jy,
+                                      double* potential = nullptr);
+
+// Plain scalar version of DirectSumAccelerations, the accuracy reference for the SIMD kernels
+void DirectSumAccelerationsScalar(const double* x, const double* y, const double* mass, std::size_t count,
+                                  double G, double eps, double* ax, double* ay, double* potential = nullptr);
+
+// Name of the instruction set used by DirectSumAccelerations on this machine
+const char* DirectSumKernelName();
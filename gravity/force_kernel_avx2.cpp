@@ -0,0 +1,36 @@
+// Built with AVX2 enabled (see gravity/CMakeLists.txt) and only called after a runtime CPU check
+
+#include "force_kernel_simd.hpp"
+
+void DirectSumAccelerationsAvx2(const double* x, const double* y, const double* mass, std::size_t count,
+                                double G, double eps, double* ax, double* ay, double* potential)
+{
+    RunSymmetricDirectSum<Avx2Lanes>(x, y, mass, count, G, eps, ax, ay, potential);
+}
+
+void DirectSumAccelerationsRangeAvx2(const double* x, const double* y, const double* mass, std::size_t count,
+                                     std::size_t begin, std::size_t end, double G, double eps, double* ax, double* ay,
+                                     double* potential)
+{
+    RunTargetDirectSum<Avx2Lanes>(x, y, mass, count, begin, end, G, eps, ax, ay, potential);
+}
+
+void DirectSumAccelerationsFloatAvx2(const float* x, const float* y, const float* mass, std::size_t count,
+                                     float G, float eps, float* ax, float* ay, double* potential)
+{
+    RunSymmetricDirectSum<Avx2FloatLanes>(x, y, mass, count, G, eps, ax, ay, potential);
+}
+
+void DirectSumAccelerationsRangeFloatAvx2(const float* x, const float* y, const float* mass, std::size_t count,
+                                          std::size_t begin, std::size_t end, float G, float eps, float* ax, float* ay,
+                                          double* potential)
+{
+    RunTargetDirectSum<Avx2FloatLanes>(x, y, mass, count, begin, end, G, eps, ax, ay, potential);
+}
+
+void DirectSumAccelerationsTargetsAvx2(const double* x, const double* y, const double* mass, std::size_t count,
+                                       const std::size_t* targets, std::size_t targetCount, double G, double eps,
+                                       double* ax, double* ay)
+{
+    GatherDirectSum<Avx2Lanes>(x, y, mass, count, targets, targetCount, G, eps, ax, ay);
+}
@@ -0,0 +1,407 @@
+#pragma once
+
+// Internal to the force kernel translation units. The direct sum kernel is written once against a small
+// set of lane operations and instantiated for each instruction set. Everything here has internal linkage
+// so that code compiled with wider instruction sets (e.g. the -mavx2 translation unit) can never be
+// picked by the linker for a caller on a machine that doesn't support it.
+
+#include <cstddef>
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
+namespace
+{
+    struct ScalarLanes
+    {
+        typedef double Scalar;
+        typedef double Type;
+        static const std::size_t WIDTH = 1;
+        static Type Set(double v) { return v; }
+        static Type Load(const double* p) { return *p; }
+        static void Store(double* p, Type v) { *p = v; }
+        static Type Add(Type a, Type b) { return a + b; }
+        static Type Sub(Type a, Type b) { return a - b; }
+        static Type Mul(Type a, Type b) { return a * b; }
+        static Type Div(Type a, Type b) { return a / b; }
+        static double Sum(Type v) { return v; }
+    };
+
+    struct ScalarFloatLanes
+    {
+        typedef float Scalar;
+        typedef float Type;
+        static const std::size_t WIDTH = 1;
+        static Type Set(float v) { return v; }
+        static Type Load(const float* p) { return *p; }
+        static void Store(float* p, Type v) { *p = v; }
+        static Type Add(Type a, Type b) { return a + b; }
+        static Type Sub(Type a, Type b) { return a - b; }
+        static Type Mul(Type a, Type b) { return a * b; }
+        static Type Div(Type a, Type b) { return a / b; }
+        static float Sum(Type v) { return v; }
+    };
+
+#if defined(__SSE2__) || defined(_M_X64)
+    struct Sse2Lanes
+    {
+        typedef double Scalar;
+        typedef __m128d Type;
+        static const std::size_t WIDTH = 2;
+        static Type Set(double v) { return _mm_set1_pd(v); }
+        static Type Load(const double* p) { return _mm_loadu_pd(p); }
+        static void Store(double* p, Type v) { _mm_storeu_pd(p, v); }
+        static Type Add(Type a, Type b) { return _mm_add_pd(a, b); }
+        static Type Sub(Type a, Type b) { return _mm_sub_pd(a, b); }
+        static Type Mul(Type a, Type b) { return _mm_mul_pd(a, b); }
+        static Type Div(Type a, Type b) { return _mm_div_pd(a, b); }
+        static double Sum(Type v) { return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v))); }
+    };
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+    struct Sse2FloatLanes
+    {
+        typedef float Scalar;
+        typedef __m128 Type;
+        static const std::size_t WIDTH = 4;
+        static Type Set(float v) { return _mm_set1_ps(v); }
+        static Type Load(const float* p) { return _mm_loadu_ps(p); }
+        static void Store(float* p, Type v) { _mm_storeu_ps(p, v); }
+        static Type Add(Type a, Type b) { return _mm_add_ps(a, b); }
+        static Type Sub(Type a, Type b) { return _mm_sub_ps(a, b); }
+        static Type Mul(Type a, Type b) { return _mm_mul_ps(a, b); }
+        static Type Div(Type a, Type b) { return _mm_div_ps(a, b); }
+        static float Sum(Type v)
+        {
+            const __m128 pair = _mm_add_ps(v, _mm_movehl_ps(v, v));
+            return _mm_cvtss_f32(_mm_add_ss(pair, _mm_shuffle_ps(pair, pair, 1)));
+        }
+    };
+#endif
+
+#if defined(__AVX2__)
+    struct Avx2Lanes
+    {
+        typedef double Scalar;
+        typedef __m256d Type;
+        static const std::size_t WIDTH = 4;
+        static Type Set(double v) { return _mm256_set1_pd(v); }
+        static Type Load(const double* p) { return _mm256_loadu_pd(p); }
+        static void Store(double* p, Type v) { _mm256_storeu_pd(p, v); }
+        static Type Add(Type a, Type b) { return _mm256_add_pd(a, b); }
+        static Type Sub(Type a, Type b) { return _mm256_sub_pd(a, b); }
+        static Type Mul(Type a, Type b) { return _mm256_mul_pd(a, b); }
+        static Type Div(Type a, Type b) { return _mm256_div_pd(a, b); }
+        static double Sum(Type v)
+        {
+            const __m128d pair = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+            return _mm_cvtsd_f64(_mm_add_sd(pair, _mm_unpackhi_pd(pair, pair)));
+        }
+    };
+#endif
+
+#if defined(__AVX2__)
+    struct Avx2FloatLanes
+    {
+        typedef float Scalar;
+        typedef __m256 Type;
+        static const std::size_t WIDTH = 8;
+        static Type Set(float v) { return _mm256_set1_ps(v); }
+        static Type Load(const float* p) { return _mm256_loadu_ps(p); }
+        static void Store(float* p, Type v) { _mm256_storeu_ps(p, v); }
+        static Type Add(Type a, Type b) { return _mm256_add_ps(a, b); }
+        static Type Sub(Type a, Type b) { return _mm256_sub_ps(a, b); }
+        static Type Mul(Type a, Type b) { return _mm256_mul_ps(a, b); }
+        static Type Div(Type a, Type b) { return _mm256_div_ps(a, b); }
+        static float Sum(Type v)
+        {
+            const __m128 quad = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+            const __m128 pair = _mm_add_ps(quad, _mm_movehl_ps(quad, quad));
+            return _mm_cvtss_f32(_mm_add_ss(pair, _mm_shuffle_ps(pair, pair, 1)));
+        }
+    };
+#endif
+
+#if defined(__wasm_simd128__)
+    struct WasmSimd128Lanes
+    {
+        typedef double Scalar;
+        typedef v128_t Type;
+        static const std::size_t WIDTH = 2;
+        static Type Set(double v) { return wasm_f64x2_splat(v); }
+        static Type Load(const double* p) { return wasm_v128_load(p); }
+        static void Store(double* p, Type v) { wasm_v128_store(p, v); }
+        static Type Add(Type a, Type b) { return wasm_f64x2_add(a, b); }
+        static Type Sub(Type a, Type b) { return wasm_f64x2_sub(a, b); }
+        static Type Mul(Type a, Type b) { return wasm_f64x2_mul(a, b); }
+        static Type Div(Type a, Type b) { return wasm_f64x2_div(a, b); }
+        static double Sum(Type v) { return wasm_f64x2_extract_lane(v, 0) + wasm_f64x2_extract_lane(v, 1); }
+    };
+
+    struct WasmSimd128FloatLanes
+    {
+        typedef float Scalar;
+        typedef v128_t Type;
+        static const std::size_t WIDTH = 4;
+        static Type Set(float v) { return wasm_f32x4_splat(v); }
+        static Type Load(const float* p) { return wasm_v128_load(p); }
+        static void Store(float* p, Type v) { wasm_v128_store(p, v); }
+        static Type Add(Type a, Type b) { return wasm_f32x4_add(a, b); }
+        static Type Sub(Type a, Type b) { return wasm_f32x4_sub(a, b); }
+        static Type Mul(Type a, Type b) { return wasm_f32x4_mul(a, b); }
+        static Type Div(Type a, Type b) { return wasm_f32x4_div(a, b); }
+        static float Sum(Type v)
+        {
+            return (wasm_f32x4_extract_lane(v, 0) + wasm_f32x4_extract_lane(v, 1)) +
+                   (wasm_f32x4_extract_lane(v, 2) + wasm_f32x4_extract_lane(v, 3));
+        }
+    };
+#endif
+
+    // Natural log of each lane. There is no vector log instruction so this goes through memory, it is only
+    // used on the (occasional) steps that also compute the potential energy. Uses the C library log rather
+    // than std::log so no inline function gets emitted from a translation unit built for a wider ISA.
+    template<class LANES>
+    typename LANES::Type Log(typename LANES::Type v)
+    {
+        typename LANES::Scalar lanes[LANES::WIDTH];
+        LANES::Store(lanes, v);
+        for (std::size_t k = 0; k < LANES::WIDTH; ++k)
+        {
+            lanes[k] = static_cast<typename LANES::Scalar>(::log(lanes[k]));
+        }
+        return LANES::Load(lanes);
+    }
+
+    // The kernels below take the scalar type T of the lanes (double or float), deduced from the arguments.
+
+    // Symmetric direct sum, see DirectSumAccelerations. For each body i the sources j > i are processed
+    // LANES::WIDTH at a time: the pull of the sources on i is accumulated in a register and the equal and
+    // opposite pull of i on the sources is applied to their (contiguous) accelerations. With POTENTIAL the
+    // pair potentials 0.5*G*m_i*m_j*ln(r^2 + eps) are summed into potential as well.
+    template<class LANES, bool POTENTIAL, class T>
+    void SymmetricDirectSum(const T* x, const T* y, const T* mass, std::size_t count,
+                            T G, T eps, T* ax, T* ay, double* potential)
+    {
+        typedef typename LANES::Type V;
+        const std::size_t width = LANES::WIDTH;
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            ax[i] = 0.0;
+            ay[i] = 0.0;
+        }
+
+        const V vG = LANES::Set(G);
+        const V vEps = LANES::Set(eps);
+        const V vOne = LANES::Set(1.0);
+        double totalPotential = 0.0;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const T xi = x[i];
+            const T yi = y[i];
+            const T gmi = G * mass[i];
+            const V vXi = LANES::Set(xi);
+            const V vYi = LANES::Set(yi);
+            const V vGmi = LANES::Set(gmi);
+            V vAxi = LANES::Set(0.0);
+            V vAyi = LANES::Set(0.0);
+            V vPoti = LANES::Set(0.0);
+
+            std::size_t j = i + 1;
+            for (; j + width <= count; j += width)
+            {
+                const V dx = LANES::Sub(LANES::Load(x + j), vXi);
+                const V dy = LANES::Sub(LANES::Load(y + j), vYi);
+                const V r2 = LANES::Add(LANES::Add(LANES::Mul(dx, dx), LANES::Mul(dy, dy)), vEps);
+                const V invR2 = LANES::Div(vOne, r2);
+                const V mj = LANES::Load(mass + j);
+                const V si = LANES::Mul(LANES::Mul(vG, mj), invR2);
+                const V sj = LANES::Mul(vGmi, invR2);
+                vAxi = LANES::Add(vAxi, LANES::Mul(si, dx));
+                vAyi = LANES::Add(vAyi, LANES::Mul(si, dy));
+                LANES::Store(ax + j, LANES::Sub(LANES::Load(ax + j), LANES::Mul(sj, dx)));
+                LANES::Store(ay + j, LANES::Sub(LANES::Load(ay + j), LANES::Mul(sj, dy)));
+                if (POTENTIAL)
+                {
+                    vPoti = LANES::Add(vPoti, LANES::Mul(mj, Log<LANES>(r2)));
+                }
+            }
+
+            T axi = LANES::Sum(vAxi);
+            T ayi = LANES::Sum(vAyi);
+            T poti = POTENTIAL ? LANES::Sum(vPoti) : T(0);
+            for (; j < count; ++j)
+            {
+                const T dx = x[j] - xi;
+                const T dy = y[j] - yi;
+                const T r2 = dx*dx + dy*dy + eps;
+                const T invR2 = T(1) / r2;
+                const T si = G * mass[j] * invR2;
+                const T sj = gmi * invR2;
+                axi += si * dx;
+                ayi += si * dy;
+                ax[j] -= sj * dx;
+                ay[j] -= sj * dy;
+                if (POTENTIAL)
+                {
+                    poti += mass[j] * ::log(r2);
+                }
+            }
+            ax[i] += axi;
+            ay[i] += ayi;
+            if (POTENTIAL)
+            {
+                totalPotential += 0.5 * gmi * poti;
+            }
+        }
+
+        if (POTENTIAL)
+        {
+            *potential = totalPotential;
+        }
+    }
+
+    // Accumulates the pull of the sources in [first, last) on the body at (xi, yi) into axi/ayi, and with
+    // POTENTIAL the sum of m_j*ln(r^2 + eps) into poti
+    template<class LANES, bool POTENTIAL, class T>
+    void AccumulateRow(const T* x, const T* y, const T* mass, std::size_t first, std::size_t last,
+                       T xi, T yi, T G, T eps, T& axi, T& ayi, T& poti)
+    {
+        typedef typename LANES::Type V;
+        const std::size_t width = LANES::WIDTH;
+        const V vXi = LANES::Set(xi);
+        const V vYi = LANES::Set(yi);
+        const V vG = LANES::Set(G);
+        const V vEps = LANES::Set(eps);
+        V vAxi = LANES::Set(0.0);
+        V vAyi = LANES::Set(0.0);
+        V vPoti = LANES::Set(0.0);
+
+        std::size_t j = first;
+        for (; j + width <= last; j += width)
+        {
+            const V dx = LANES::Sub(LANES::Load(x + j), vXi);
+            const V dy = LANES::Sub(LANES::Load(y + j), vYi);
+            const V r2 = LANES::Add(LANES::Add(LANES::Mul(dx, dx), LANES::Mul(dy, dy)), vEps);
+            const V mj = LANES::Load(mass + j);
+            const V s = LANES::Div(LANES::Mul(vG, mj), r2);
+            vAxi = LANES::Add(vAxi, LANES::Mul(s, dx));
+            vAyi = LANES::Add(vAyi, LANES::Mul(s, dy));
+            if (POTENTIAL)
+            {
+                vPoti = LANES::Add(vPoti, LANES::Mul(mj, Log<LANES>(r2)));
+            }
+        }
+
+        axi += LANES::Sum(vAxi);
+        ayi += LANES::Sum(vAyi);
+        if (POTENTIAL)
+        {
+            poti += LANES::Sum(vPoti);
+        }
+        for (; j < last; ++j)
+        {
+            const T dx = x[j] - xi;
+            const T dy = y[j] - yi;
+            const T r2 = dx*dx + dy*dy + eps;
+            const T s = G * mass[j] / r2;
+            axi += s * dx;
+            ayi += s * dy;
+            if (POTENTIAL)
+            {
+                poti += mass[j] * ::log(r2);
+            }
+        }
+    }
+
+    // Full rows of the direct sum for the targets [begin, end), see DirectSumAccelerationsRange. Unlike
+    // SymmetricDirectSum each target only writes its own acceleration, so ranges can run concurrently.
+    template<class LANES, bool POTENTIAL, class T>
+    void TargetDirectSum(const T* x, const T* y, const T* mass, std::size_t count,
+                         std::size_t begin, std::size_t end, T G, T eps, T* ax, T* ay,
+                         double* potential)
+    {
+        double totalPotential = 0.0;
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            T axi = 0.0;
+            T ayi = 0.0;
+            T poti = 0.0;
+            // Skip the target itself rather than relying on a zero separation, which is NaN without softening
+            AccumulateRow<LANES, POTENTIAL>(x, y, mass, 0, i, x[i], y[i], G, eps, axi, ayi, poti);
+            AccumulateRow<LANES, POTENTIAL>(x, y, mass, i + 1, count, x[i], y[i], G, eps, axi, ayi, poti);
+            ax[i] = axi;
+            ay[i] = ayi;
+            if (POTENTIAL)
+            {
+                // Every pair is seen from both ends, so each end carries half of the pair potential
+                totalPotential += 0.25 * G * mass[i] * poti;
+            }
+        }
+
+        if (POTENTIAL)
+        {
+            *potential = totalPotential;
+        }
+    }
+
+    // Full rows of the direct sum for an arbitrary list of targets, see DirectSumAccelerationsTargets
+    template<class LANES, class T>
+    void GatherDirectSum(const T* x, const T* y, const T* mass, std::size_t count,
+                         const std::size_t* targets, std::size_t targetCount, T G, T eps, T* ax, T* ay)
+    {
+        for (std::size_t k = 0; k < targetCount; ++k)
+        {
+            const std::size_t i = targets[k];
+            T axi = 0.0;
+            T ayi = 0.0;
+            T poti = 0.0;
+            AccumulateRow<LANES, false>(x, y, mass, 0, i, x[i], y[i], G, eps, axi, ayi, poti);
+            AccumulateRow<LANES, false>(x, y, mass, i + 1, count, x[i], y[i], G, eps, axi, ayi, poti);
+            ax[k] = axi;
+            ay[k] = ayi;
+        }
+    }
+
+    // Picks the instantiation for the runtime potential flag
+    template<class LANES, class T>
+    void RunSymmetricDirectSum(const T* x, const T* y, const T* mass, std::size_t count,
+                               T G, T eps, T* ax, T* ay, double* potential)
+    {
+        if (potential)
+        {
+            SymmetricDirectSum<LANES, true>(x, y, mass, count, G, eps, ax, ay, potential);
+        }
+        else
+        {
+            SymmetricDirectSum<LANES, false>(x, y, mass, count, G, eps, ax, ay, potential);
+        }
+    }
+
+    template<class LANES, class T>
+    void RunTargetDirectSum(const T* x, const T* y, const T* mass, std::size_t count,
+                            std::size_t begin, std::size_t end, T G, T eps, T* ax, T* ay,
+                            double* potential)
+    {
+        if (potential)
+        {
+            TargetDirectSum<LANES, true>(x, y, mass, count, begin, end, G, eps, ax, ay, potential);
+        }
+        else
+        {
+            TargetDirectSum<LANES, false>(x, y, mass, count, begin, end, G, eps, ax, ay, potential);
+        }
+    }
+}
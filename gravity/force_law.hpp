@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cmath>
+
+// Softening added to the squared separation of two bodies when softening is enabled
+static const double SOFTENING = 0.01;
+
+// Accumulates the acceleration of a body due to a source body of mass sourceMass, where (dx, dy) is the
+// separation from the body to the source. This is the same law as Body::ForceExertedBy (the reference),
+// i.e. a force of magnitude G*m1*m2 / (r^2 + eps) applied along the (unnormalised) separation vector.
+inline void AccumulatePairAcceleration(double dx, double dy, double sourceMass, double G, double eps,
+                                       double& ax, double& ay)
+{
+    const double scale = G * sourceMass / (dx*dx + dy*dy + eps);
+    ax += scale * dx;
+    ay += scale * dy;
+}
+
+// Potential energy of a pair of bodies at separation (dx, dy) consistent with the force above (the force is
+// minus its gradient), i.e. the logarithmic potential of gravity in two dimensions. Only differences in it
+// are meaningful, it is zero at r^2 + eps = 1.
+inline double PairPotential(double dx, double dy, double mass1, double mass2, double G, double eps)
+{
+    return 0.5 * G * mass1 * mass2 * std::log(dx*dx + dy*dy + eps);
+}
+
+// Speed of a circular orbit of radius r about an enclosed mass (treated as a point at the centre) under the
+// law above, v^2 = |a|*r = G*M*r^2 / (r^2 + eps)
+inline double CircularSpeed(double G, double enclosedMass, double r, double eps)
+{
+    return std::sqrt(G * enclosedMass * r * r / (r * r + eps));
+}
@@ -0,0 +1,179 @@
+#include "generators.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "force_law.hpp"
+
+namespace
+{
+    const double PI = 3.14159265358979323846;
+
+    // mt19937_64 output is fully specified by the standard, unlike the std distributions, so build the
+    // samples directly from its bits to get the same bodies on every platform
+    class Random
+    {
+    public:
+        explicit Random(unsigned int seed) : m_engine(seed) {};
+
+        // Uniform in [0, 1)
+        double Uniform()
+        {
+            return static_cast<double>(m_engine() >> 11) * (1.0 / 9007199254740992.0);
+        }
+
+        double Uniform(double min, double max)
+        {
+            return min + (max - min) * Uniform();
+        }
+
+        // Standard normal (Box-Muller)
+        double Normal()
+        {
+            const double u1 = 1.0 - Uniform();
+            const double u2 = Uniform();
+            return std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * PI * u2);
+        }
+
+    private:
+        std::mt19937_64 m_engine;
+    };
+
+    struct Columns
+    {
+        explicit Columns(std::size_t count)
+        {
+            Mass.reserve(count);
+            Radius.reserve(count);
+            X.reserve(count);
+            Y.reserve(count);
+            VX.reserve(count);
+            VY.reserve(count);
+        }
+
+        void Add(double mass, double radius, double x, double y, double vx, double vy)
+        {
+            Mass.push_back(mass);
+            Radius.push_back(radius);
+            X.push_back(x);
+            Y.push_back(y);
+            VX.push_back(vx);
+            VY.push_back(vy);
+        }
+
+        void AddTo(Simulation& sim, bool isStatic = false) const
+        {
+            sim.AddBodies(Mass.size(), Mass.data(), Radius.data(), X.data(), Y.data(), VX.data(), VY.data(), isStatic);
+        }
+
+        std::vector<double> Mass, Radius, X, Y, VX, VY;
+    };
+
+    // Rotating disk centred on (cx, cy) moving with (cvx, cvy)
+    void AddDisk(Columns& bodies, Random& rng, double G, double eps, unsigned int count, double diskRadius,
+                 double totalMass, double bodyRadius, double cx, double cy, double cvx, double cvy)
+    {
+        const double mass = totalMass / count;
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            // Area uniform, so the mass enclosed within r is proportional to r^2
+            const double fraction = rng.Uniform();
+            const double r = diskRadius * std::sqrt(fraction);
+            const double angle = rng.Uniform(-PI, PI);
+            const double speed = CircularSpeed(G, totalMass * fraction, r, eps);
+            bodies.Add(mass, bodyRadius,
+                       cx + r * std::cos(angle), cy + r * std::sin(angle),
+                       cvx - std::sin(angle) * speed, cvy + std::cos(angle) * speed);
+        }
+    }
+}
+
+void GenerateRing(Simulation& sim, unsigned int count, double innerRadius, double outerRadius,
+                  double minMass, double maxMass, double bodyRadius, double minSpeed, double maxSpeed,
+                  unsigned int seed)
+{
+    Random rng(seed);
+    Columns bodies(count);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        const double r = std::sqrt(rng.Uniform(innerRadius * innerRadius, outerRadius * outerRadius));
+        const double angle = rng.Uniform(-PI, PI);
+        const double mass = rng.Uniform(minMass, maxMass);
+        const double speed = rng.Uniform(minSpeed, maxSpeed);
+        bodies.Add(mass, bodyRadius, r * std::cos(angle), r * std::sin(angle),
+                   -std::sin(angle) * speed, std::cos(angle) * speed);
+    }
+    bodies.AddTo(sim);
+}
+
+void GenerateUniformDisk(Simulation& sim, unsigned int count, double diskRadius, double totalMass,
+                         double bodyRadius, unsigned int seed)
+{
+    Random rng(seed);
+    Columns bodies(count);
+    AddDisk(bodies, rng, sim.G(), sim.Softening(), count, diskRadius, totalMass, bodyRadius, 0.0, 0.0, 0.0, 0.0);
+    bodies.AddTo(sim);
+}
+
+void GenerateAttractorField(Simulation& sim, unsigned int staticCount, unsigned int testCount, double diskRadius,
+                            double totalMass, double bodyRadius, unsigned int seed)
+{
+    Random rng(seed);
+    Columns attractors(staticCount);
+    AddDisk(attractors, rng, sim.G(), sim.Softening(), staticCount, diskRadius, totalMass, bodyRadius, 0.0, 0.0, 0.0, 0.0);
+    attractors.AddTo(sim, true);
+
+    // The orbits only depend on the mass enclosed, so the test bodies are a second disk with next to no mass
+    Columns bodies(testCount);
+    AddDisk(bodies, rng, sim.G(), sim.Softening(), testCount, diskRadius, totalMass, bodyRadius, 0.0, 0.0, 0.0, 0.0);
+    for (double& mass : bodies.Mass)
+    {
+        mass *= 1e-6;
+    }
+    bodies.AddTo(sim);
+}
+
+void GeneratePlummer(Simulation& sim, unsigned int count, double scaleRadius, double totalMass,
+                     double bodyRadius, unsigned int seed)
+{
+    Random rng(seed);
+    Columns bodies(count);
+    const double mass = totalMass / count;
+
+    // Every pair contributes G*m_i*m_j to the virial under the engine's force law, so 2K = G*(M^2 - sum m^2)/2
+    // which gives the mean square speed, split evenly over the two velocity components
+    const double meanSquareSpeed = count > 0 ? sim.G() * (totalMass * totalMass - count * mass * mass) / (2.0 * totalMass) : 0.0;
+    const double sigma = std::sqrt(0.5 * meanSquareSpeed);
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        // Projected Plummer profile, M(<R) = M * R^2 / (R^2 + a^2), inverted for R
+        // (the far tail is cut off, otherwise the odd body lands millions of scale radii away)
+        double fraction = rng.Uniform();
+        while (fraction > 0.999)
+        {
+            fraction = rng.Uniform();
+        }
+        const double r = scaleRadius * std::sqrt(fraction / (1.0 - fraction));
+        const double angle = rng.Uniform(-PI, PI);
+        bodies.Add(mass, bodyRadius, r * std::cos(angle), r * std::sin(angle), sigma * rng.Normal(), sigma * rng.Normal());
+    }
+    bodies.AddTo(sim);
+}
+
+void GenerateGalaxyCollision(Simulation& sim, unsigned int countPerGalaxy, double diskRadius, double galaxyMass,
+                             double separation, double approachSpeed, double bodyRadius, unsigned int seed)
+{
+    Random rng(seed);
+    Columns bodies(2 * static_cast<std::size_t>(countPerGalaxy));
+    const double G = sim.G();
+    const double eps = sim.Softening();
+    const double offset = 0.5 * diskRadius;
+    AddDisk(bodies, rng, G, eps, countPerGalaxy, diskRadius, galaxyMass, bodyRadius,
+            -0.5 * separation, -0.5 * offset, 0.5 * approachSpeed, 0.0);
+    AddDisk(bodies, rng, G, eps, countPerGalaxy, diskRadius, galaxyMass, bodyRadius,
+            0.5 * separation, 0.5 * offset, -0.5 * approachSpeed, 0.0);
+    bodies.AddTo(sim);
+}
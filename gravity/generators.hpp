@@ -0,0 +1,33 @@
+#pragma once
+
+#include "simulation.hpp"
+
+// Initial condition generators. Each one appends its bodies to the simulation in a single bulk add, using
+// the simulation's current G and softening to set up orbital velocities. The same seed always produces the
+// same bodies (the random numbers are generated without the implementation defined std distributions).
+
+// Bodies spread uniformly over an annulus with tangential speed in [minSpeed, maxSpeed] - the rotating
+// ring setup from browser/index.html
+void GenerateRing(Simulation& sim, unsigned int count, double innerRadius, double outerRadius,
+                  double minMass, double maxMass, double bodyRadius, double minSpeed, double maxSpeed,
+                  unsigned int seed);
+
+// Equal mass bodies spread uniformly over a disk of the given radius, each on a circular orbit about the
+// mass enclosed by its own orbit
+void GenerateUniformDisk(Simulation& sim, unsigned int count, double diskRadius, double totalMass,
+                         double bodyRadius, unsigned int seed);
+
+// Test bodies of negligible mass on circular orbits inside a uniform disk of staticCount static bodies of
+// the given total mass, e.g. stars in a fixed galactic potential
+void GenerateAttractorField(Simulation& sim, unsigned int staticCount, unsigned int testCount, double diskRadius,
+                            double totalMass, double bodyRadius, unsigned int seed);
+
+// Equal mass bodies following the (projected) Plummer profile with scale radius a, with isotropic random
+// velocities sized so the system starts in virial equilibrium
+void GeneratePlummer(Simulation& sim, unsigned int count, double scaleRadius, double totalMass,
+                     double bodyRadius, unsigned int seed);
+
+// Two rotating uniform disks of countPerGalaxy bodies each, separated by separation along x and approaching
+// each other with the given relative speed plus an offset along y so they collide off-centre
+void GenerateGalaxyCollision(Simulation& sim, unsigned int countPerGalaxy, double diskRadius, double galaxyMass,
+                             double separation, double approachSpeed, double bodyRadius, unsigned int seed);
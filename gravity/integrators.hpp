@@ -0,0 +1,135 @@
+#pragma once
+
+// Integrators as policy classes, Simulation picks one at construction and instantiates its step loop
+// for it, so there is no per-step dispatch on the method. Each policy advances a system by dt using
+// the system's primitives:
+//   Kick(h)      v += h*a for the dynamic bodies
+//   Drift(h)     x += h*v for the dynamic bodies
+//   ComputeAccelerations(diagnose)   a at the current positions (and the potential when diagnosing)
+// and expects the accelerations at the start of the step to be valid (Prepare() makes them so). Only the
+// last force evaluation of a step is asked for the potential, so diagnostics are taken at the end of it.
+
+// First order semi-implicit (symplectic) Euler
+// v_n+1 = v_n + a(r_n)*dt
+// r_n+1 = r_n + v_n+1*dt
+struct EulerIntegrator
+{
+    template<class SYSTEM>
+    static void Prepare(SYSTEM& system) { system.ComputeAccelerations(false); }
+
+    template<class SYSTEM>
+    static void Step(SYSTEM& system, double dt, bool diagnose)
+    {
+        system.Kick(dt);
+        system.Drift(dt);
+        system.ComputeAccelerations(diagnose);
+    }
+};
+
+// Second order Taylor series
+// r_n+1 = r_n + v_n*dt + 0.5*a(r_n)*dt*dt
+// v_n+1 = v_n + a(r_n)*dt
+struct TaylorIntegrator
+{
+    template<class SYSTEM>
+    static void Prepare(SYSTEM& system) { system.ComputeAccelerations(false); }
+
+    template<class SYSTEM>
+    static void Step(SYSTEM& system, double dt, bool diagnose)
+    {
+        system.Kick(0.5*dt);
+        system.Drift(dt);
+        system.Kick(0.5*dt);
+        system.ComputeAccelerations(diagnose);
+    }
+};
+
+// Second order kick-drift-kick leapfrog, one force evaluation per step
+// v_n+0.5 = v_n + 0.5*dt*a(r_n)
+// r_n+1 = r_n + dt*v_n+0.5
+// v_n+1 = v_n+0.5 + 0.5*dt*a(r_n+1)
+struct LeapfrogIntegrator
+{
+    template<class SYSTEM>
+    static void Prepare(SYSTEM& system) { system.ComputeAccelerations(false); }
+
+    template<class SYSTEM>
+    static void Step(SYSTEM& system, double dt, bool diagnose)
+    {
+        system.Kick(0.5*dt);
+        system.Drift(dt);
+        system.ComputeAccelerations(diagnose);
+        system.Kick(0.5*dt);
+    }
+};
+
+// Fourth order Yoshida "triple jump", three leapfrog steps of w1*dt, w0*dt, w1*dt with the middle one
+// backwards in time. Three force evaluations per step. This is the same integrator as Forest & Ruth (1990).
+struct YoshidaIntegrator
+{
+    template<class SYSTEM>
+    static void Prepare(SYSTEM& system) { system.ComputeAccelerations(false); }
+
+    template<class SYSTEM>
+    static void Step(SYSTEM& system, double dt, bool diagnose)
+    {
+        // w1 = 1 / (2 - 2^(1/3)), w0 = 1 - 2*w1
+        const double w1 = 1.3512071919596576;
+        const double w0 = -1.7024143839193153;
+        LeapfrogIntegrator::Step(system, w1*dt, false);
+        LeapfrogIntegrator::Step(system, w0*dt, false);
+        LeapfrogIntegrator::Step(system, w1*dt, diagnose);
+    }
+};
+
+// Fourth order velocity-extended Forest-Ruth-like integrator (VEFRL, Omelyan, Mryglod & Folk 2002), which
+// starts and ends on a kick. Four force evaluations per step but a much smaller error constant than the
+// triple jump.
+struct OmelyanIntegrator
+{
+    template<class SYSTEM>
+    static void Prepare(SYSTEM& system) { system.ComputeAccelerations(false); }
+
+    template<class SYSTEM>
+    static void Step(SYSTEM& system, double dt, bool diagnose)
+    {
+        const double xi = 0.1644986515575760;
+        const double lambda = -0.02094333910398989;
+        const double chi = 1.235692651138917;
+        system.Kick(xi*dt);
+        system.Drift(0.5*(1.0 - 2.0*lambda)*dt);
+        system.ComputeAccelerations(false);
+        system.Kick(chi*dt);
+        system.Drift(lambda*dt);
+        system.ComputeAccelerations(false);
+        system.Kick((1.0 - 2.0*(chi + xi))*dt);
+        system.Drift(lambda*dt);
+        system.ComputeAccelerations(false);
+        system.Kick(chi*dt);
+        system.Drift(0.5*(1.0 - 2.0*lambda)*dt);
+        system.ComputeAccelerations(diagnose);
+        system.Kick(xi*dt);
+    }
+};
+
+// Fourth order Hermite predictor-corrector (Makino & Aarseth 1992). Needs the jerk (da/dt) alongside
+// the acceleration, which the system evaluates by direct summation, and these additional primitives:
+//   SaveState()   keep x, v, a and jerk at the start of the step
+//   Predict(h)    Taylor expand x and v to third and second order
+//   ComputeAccelerationsAndJerks(diagnose)
+//   Correct(h)    Hermite interpolation of the accelerations and jerks at both ends of the step
+// One (direct sum) force evaluation per step, not symplectic.
+struct HermiteIntegrator
+{
+    template<class SYSTEM>
+    static void Prepare(SYSTEM& system) { system.ComputeAccelerationsAndJerks(false); }
+
+    template<class SYSTEM>
+    static void Step(SYSTEM& system, double dt, bool diagnose)
+    {
+        system.SaveState();
+        system.Predict(dt);
+        system.ComputeAccelerationsAndJerks(diagnose);
+        system.Correct(dt);
+    }
+};
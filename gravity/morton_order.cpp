@@ -0,0 +1,91 @@
+#include "morton_order.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace
+{
+    const double CELLS = 65535.0;
+
+    // Spreads the low 16 bits of v out to the even bits
+    unsigned long long SpreadBits(unsigned long long v)
+    {
+        v &= 0xffffull;
+        v = (v | (v << 8)) & 0x00ff00ffull;
+        v = (v | (v << 4)) & 0x0f0f0f0full;
+        v = (v | (v << 2)) & 0x33333333ull;
+        v = (v | (v << 1)) & 0x55555555ull;
+        return v;
+    }
+
+    unsigned long long Cell(double value, double min, double scale)
+    {
+        // Also catches NaN, which sorts into the first cell
+        const double cell = (value - min) * scale;
+        return cell > 0.0 ? static_cast<unsigned long long>(std::min(cell, CELLS)) : 0ull;
+    }
+}
+
+void MortonOrder(const double* x, const double* y, std::size_t count, std::vector<std::size_t>& order,
+                 std::vector<unsigned long long>& keys)
+{
+    order.resize(count);
+    if (count == 0)
+    {
+        return;
+    }
+
+    double minX = x[0];
+    double maxX = x[0];
+    double minY = y[0];
+    double maxY = y[0];
+    for (std::size_t i = 1; i < count; ++i)
+    {
+        minX = std::min(minX, x[i]);
+        maxX = std::max(maxX, x[i]);
+        minY = std::min(minY, y[i]);
+        maxY = std::max(maxY, y[i]);
+    }
+    // One scale for both axes keeps the cells square
+    const double extent = std::max(maxX - minX, maxY - minY);
+    const double scale = extent > 0.0 && std::isfinite(extent) ? CELLS / extent : 0.0;
+
+    // The key goes in the top 32 bits and the index in the bottom 32 (ids are 32 bit, so there are never more
+    // bodies than that). An LSD radix sort on the key bytes, which is stable, so ties stay in index order.
+    // The second half of keys is the buffer each pass scatters into.
+    keys.resize(2 * count);
+    unsigned long long* from = keys.data();
+    unsigned long long* to = keys.data() + count;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const unsigned long long key = SpreadBits(Cell(x[i], minX, scale)) | (SpreadBits(Cell(y[i], minY, scale)) << 1);
+        from[i] = (key << 32) | static_cast<unsigned long long>(i);
+    }
+    for (unsigned int shift = 32; shift < 64; shift += 8)
+    {
+        std::size_t offsets[257] = {};
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            ++offsets[((from[i] >> shift) & 0xff) + 1];
+        }
+        if (offsets[((from[0] >> shift) & 0xff) + 1] == count)
+        {
+            // Every key has the same byte here
+            continue;
+        }
+        for (std::size_t b = 1; b < 257; ++b)
+        {
+            offsets[b] += offsets[b - 1];
+        }
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            to[offsets[(from[i] >> shift) & 0xff]++] = from[i];
+        }
+        std::swap(from, to);
+    }
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        order[i] = static_cast<std::size_t>(from[i] & 0xffffffffull);
+    }
+}
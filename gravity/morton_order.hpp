@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Sorts count bodies along a Morton (Z-order) curve over their bounding box, so bodies close in space end up
+// close in memory. Fills order with the index of the body that goes at each position (see
+// BodyStore::Permute), keys is scratch. Bodies in the same cell of the 65536^2 grid the curve is taken on
+// keep their relative order.
+void MortonOrder(const double* x, const double* y, std::size_t count, std::vector<std::size_t>& order,
+                 std::vector<unsigned long long>& keys);
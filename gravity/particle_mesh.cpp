@@ -0,0 +1,318 @@
+#include "particle_mesh.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+namespace
+{
+    const double PI = 3.14159265358979323846;
+
+    std::size_t NextPowerOfTwo(std::size_t n)
+    {
+        std::size_t power = 1;
+        while (power < n)
+        {
+            power <<= 1;
+        }
+        return power;
+    }
+
+    // Cloud-in-cell: the node below/left of the body and the weight of the node above/right of it
+    void CicWeights(double position, double origin, double spacing, std::size_t nodes, std::size_t& index, double& weight)
+    {
+        const double f = (position - origin) / spacing;
+        const double cell = std::floor(f);
+        const double maxCell = static_cast<double>(nodes - 2);
+        const double clamped = std::min(std::max(cell, 0.0), maxCell);
+        index = static_cast<std::size_t>(clamped);
+        weight = std::min(std::max(f - clamped, 0.0), 1.0);
+    }
+}
+
+ParticleMeshSolver::ParticleMeshSolver() :
+        m_nodes(0),
+        m_padded(0),
+        m_greensSpacing(0.0),
+        m_greensG(0.0),
+        m_greensEps(0.0)
+{
+    GridSize(128);
+}
+
+unsigned int ParticleMeshSolver::GridSize() const
+{
+    return static_cast<unsigned int>(m_nodes);
+}
+
+void ParticleMeshSolver::Reserve(unsigned int threadCount)
+{
+    m_greens.reserve(m_padded * m_padded);
+    m_grid.reserve(m_padded * m_padded);
+    m_columns.reserve(threadCount * m_padded);
+    m_potential.reserve(m_nodes * m_nodes);
+    m_gridAX.reserve(m_nodes * m_nodes);
+    m_gridAY.reserve(m_nodes * m_nodes);
+}
+
+std::size_t ParticleMeshSolver::MemoryBytes() const
+{
+    return (m_twiddles.capacity() + m_greens.capacity() + m_grid.capacity() + m_columns.capacity()) * sizeof(Complex) +
+           m_bitReverse.capacity() * sizeof(std::size_t) +
+           (m_potential.capacity() + m_gridAX.capacity() + m_gridAY.capacity()) * sizeof(double);
+}
+
+void ParticleMeshSolver::GridSize(unsigned int nodes)
+{
+    const std::size_t size = NextPowerOfTwo(std::max(4u, nodes));
+    if (size == m_nodes)
+    {
+        return;
+    }
+
+    m_nodes = size;
+    m_padded = 2 * size;
+
+    m_twiddles.resize(m_padded / 2);
+    for (std::size_t k = 0; k < m_padded / 2; ++k)
+    {
+        m_twiddles[k] = std::polar(1.0, -2.0 * PI * k / m_padded);
+    }
+
+    std::size_t bits = 0;
+    while ((std::size_t(1) << bits) < m_padded)
+    {
+        ++bits;
+    }
+    m_bitReverse.resize(m_padded);
+    for (std::size_t i = 0; i < m_padded; ++i)
+    {
+        std::size_t reversed = 0;
+        for (std::size_t b = 0; b < bits; ++b)
+        {
+            reversed |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        m_bitReverse[i] = reversed;
+    }
+
+    m_greens.clear();
+    m_greensSpacing = 0.0;
+}
+
+double ParticleMeshSolver::Green(double dx, double dy, double spacing) const
+{
+    // Potential per unit source mass under the engine's force law (see PairPotential), with the
+    // singularity at zero separation replaced by the value at a quarter of a cell
+    double r2 = (dx*dx + dy*dy) * spacing * spacing;
+    if (r2 == 0.0)
+    {
+        r2 = 0.25 * spacing * spacing;
+    }
+    return 0.5 * m_greensG * std::log(r2 + m_greensEps);
+}
+
+void ParticleMeshSolver::PrepareGreensFunction(double spacing, double G, double eps, ThreadPool& pool)
+{
+    if (!m_greens.empty() && spacing == m_greensSpacing && G == m_greensG && eps == m_greensEps)
+    {
+        return;
+    }
+    m_greensSpacing = spacing;
+    m_greensG = G;
+    m_greensEps = eps;
+
+    // Separations wrap around the padded grid so the circular convolution gives the isolated result
+    const std::size_t padded = m_padded;
+    m_greens.assign(padded * padded, Complex(0.0, 0.0));
+    for (std::size_t j = 0; j < padded; ++j)
+    {
+        const double dy = static_cast<double>(j <= m_nodes ? j : padded - j);
+        for (std::size_t i = 0; i < padded; ++i)
+        {
+            const double dx = static_cast<double>(i <= m_nodes ? i : padded - i);
+            m_greens[j * padded + i] = Complex(Green(dx, dy, spacing), 0.0);
+        }
+    }
+    Fft2D(m_greens, false, pool);
+}
+
+void ParticleMeshSolver::Fft(Complex* data, bool inverse) const
+{
+    // Iterative radix-2 Cooley-Tukey on m_padded points
+    const std::size_t n = m_padded;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const std::size_t j = m_bitReverse[i];
+        if (i < j)
+        {
+            std::swap(data[i], data[j]);
+        }
+    }
+
+    for (std::size_t length = 2; length <= n; length <<= 1)
+    {
+        const std::size_t half = length / 2;
+        const std::size_t step = n / length;
+        for (std::size_t start = 0; start < n; start += length)
+        {
+            for (std::size_t k = 0; k < half; ++k)
+            {
+                const Complex w = inverse ? std::conj(m_twiddles[k * step]) : m_twiddles[k * step];
+                const Complex even = data[start + k];
+                const Complex odd = data[start + k + half] * w;
+                data[start + k] = even + odd;
+                data[start + k + half] = even - odd;
+            }
+        }
+    }
+}
+
+void ParticleMeshSolver::Fft2D(std::vector<Complex>& data, bool inverse, ThreadPool& pool)
+{
+    const std::size_t n = m_padded;
+    pool.ParallelFor(n, 8, [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t row = begin; row < end; ++row)
+        {
+            Fft(&data[row * n], inverse);
+        }
+    });
+
+    // The columns are split evenly into one block per thread, so each block has its own column of scratch
+    const std::size_t blocks = pool.ThreadCount();
+    m_columns.resize(blocks * n);
+    pool.ParallelFor(blocks, 1, [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t block = begin; block < end; ++block)
+        {
+            Complex* column = &m_columns[block * n];
+            for (std::size_t col = block * n / blocks; col < (block + 1) * n / blocks; ++col)
+            {
+                for (std::size_t row = 0; row < n; ++row)
+                {
+                    column[row] = data[row * n + col];
+                }
+                Fft(column, inverse);
+                for (std::size_t row = 0; row < n; ++row)
+                {
+                    data[row * n + col] = column[row];
+                }
+            }
+        }
+    });
+}
+
+void ParticleMeshSolver::Accelerations(const double* x, const double* y, const double* mass, std::size_t count,
+                                       double G, double eps, double minX, double minY, double size,
+                                       double* ax, double* ay, double* potential, ThreadPool& pool)
+{
+    const std::size_t nodes = m_nodes;
+    const std::size_t padded = m_padded;
+    const double spacing = size / static_cast<double>(nodes - 1);
+    PrepareGreensFunction(spacing, G, eps, pool);
+
+    // Deposit the mass onto the (zero padded) grid
+    m_grid.assign(padded * padded, Complex(0.0, 0.0));
+    for (std::size_t b = 0; b < count; ++b)
+    {
+        std::size_t i, j;
+        double wx, wy;
+        CicWeights(x[b], minX, spacing, nodes, i, wx);
+        CicWeights(y[b], minY, spacing, nodes, j, wy);
+        const double m = mass[b];
+        m_grid[j * padded + i] += m * (1.0 - wx) * (1.0 - wy);
+        m_grid[j * padded + i + 1] += m * wx * (1.0 - wy);
+        m_grid[(j + 1) * padded + i] += m * (1.0 - wx) * wy;
+        m_grid[(j + 1) * padded + i + 1] += m * wx * wy;
+    }
+
+    // Convolve with the Green's function
+    Fft2D(m_grid, false, pool);
+    for (std::size_t k = 0; k < m_grid.size(); ++k)
+    {
+        m_grid[k] *= m_greens[k];
+    }
+    Fft2D(m_grid, true, pool);
+
+    const double norm = 1.0 / static_cast<double>(padded * padded);
+    m_potential.resize(nodes * nodes);
+    for (std::size_t j = 0; j < nodes; ++j)
+    {
+        for (std::size_t i = 0; i < nodes; ++i)
+        {
+            m_potential[j * nodes + i] = m_grid[j * padded + i].real() * norm;
+        }
+    }
+
+    // a = -grad(potential), central differences inside the mesh and one sided on its edges
+    m_gridAX.resize(nodes * nodes);
+    m_gridAY.resize(nodes * nodes);
+    const double invSpacing = 1.0 / spacing;
+    for (std::size_t j = 0; j < nodes; ++j)
+    {
+        for (std::size_t i = 0; i < nodes; ++i)
+        {
+            const std::size_t left = i > 0 ? i - 1 : i;
+            const std::size_t right = i + 1 < nodes ? i + 1 : i;
+            const std::size_t down = j > 0 ? j - 1 : j;
+            const std::size_t up = j + 1 < nodes ? j + 1 : j;
+            m_gridAX[j * nodes + i] = -(m_potential[j * nodes + right] - m_potential[j * nodes + left]) * invSpacing / (right - left);
+            m_gridAY[j * nodes + i] = -(m_potential[up * nodes + i] - m_potential[down * nodes + i]) * invSpacing / (up - down);
+        }
+    }
+
+    // Interpolate back to the bodies with the same weights used for the deposit, so a body exerts no net
+    // force on itself
+    double totalPotential = 0.0;
+    std::mutex potentialMutex;
+    pool.ParallelFor(count, 0, [&](std::size_t begin, std::size_t end)
+    {
+        double chunkPotential = 0.0;
+        for (std::size_t b = begin; b < end; ++b)
+        {
+            std::size_t i, j;
+            double wx, wy;
+            CicWeights(x[b], minX, spacing, nodes, i, wx);
+            CicWeights(y[b], minY, spacing, nodes, j, wy);
+            const std::size_t n00 = j * nodes + i;
+            const std::size_t n10 = n00 + 1;
+            const std::size_t n01 = n00 + nodes;
+            const std::size_t n11 = n01 + 1;
+            const double w00 = (1.0 - wx) * (1.0 - wy);
+            const double w10 = wx * (1.0 - wy);
+            const double w01 = (1.0 - wx) * wy;
+            const double w11 = wx * wy;
+            ax[b] = w00 * m_gridAX[n00] + w10 * m_gridAX[n10] + w01 * m_gridAX[n01] + w11 * m_gridAX[n11];
+            ay[b] = w00 * m_gridAY[n00] + w10 * m_gridAY[n10] + w01 * m_gridAY[n01] + w11 * m_gridAY[n11];
+
+            if (potential)
+            {
+                const double phi = w00 * m_potential[n00] + w10 * m_potential[n10] + w01 * m_potential[n01] + w11 * m_potential[n11];
+
+                // Remove the body's interaction with its own deposited mass
+                const double weights[4] = { w00, w10, w01, w11 };
+                const int offsetX[4] = { 0, 1, 0, 1 };
+                const int offsetY[4] = { 0, 0, 1, 1 };
+                double self = 0.0;
+                for (int a = 0; a < 4; ++a)
+                {
+                    for (int c = 0; c < 4; ++c)
+                    {
+                        self += weights[a] * weights[c] * Green(offsetX[a] - offsetX[c], offsetY[a] - offsetY[c], spacing);
+                    }
+                }
+                chunkPotential += 0.5 * mass[b] * (phi - mass[b] * self);
+            }
+        }
+        if (potential)
+        {
+            std::lock_guard<std::mutex> lock(potentialMutex);
+            totalPotential += chunkPotential;
+        }
+    });
+
+    if (potential)
+    {
+        *potential = totalPotential;
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+// Particle-mesh gravity solver. Mass is deposited onto a square grid with cloud-in-cell weights, the
+// potential is found by convolving it with the Green's function of the engine's force law using FFTs on a
+// grid padded to twice the size (so the boundaries are isolated rather than periodic), and the grid
+// accelerations are interpolated back to the bodies with the same weights. Cost is O(N + G log G) for a
+// grid of G cells, forces are smoothed on the scale of a cell.
+class ParticleMeshSolver
+{
+public:
+    ParticleMeshSolver();
+
+    // Grid nodes along each side of the mesh, rounded up to a power of two
+    unsigned int GridSize() const;
+    void GridSize(unsigned int nodes);
+
+    // Allocates the grids for the current grid size, and the FFT scratch for threadCount threads, up front
+    // rather than on the first solve
+    void Reserve(unsigned int threadCount);
+    // Bytes allocated for the grids and FFT tables
+    std::size_t MemoryBytes() const;
+
+    // Overwrites ax/ay with the accelerations of the bodies. The mesh covers the square with corner
+    // (minX, minY) and the given side length, every body must lie inside it. If potential is not null the
+    // potential energy of the bodies is written to it.
+    void Accelerations(const double* x, const double* y, const double* mass, std::size_t count,
+                       double G, double eps, double minX, double minY, double size,
+                       double* ax, double* ay, double* potential, ThreadPool& pool);
+
+private:
+    typedef std::complex<double> Complex;
+
+    void PrepareGreensFunction(double spacing, double G, double eps, ThreadPool& pool);
+    void Fft2D(std::vector<Complex>& data, bool inverse, ThreadPool& pool);
+    void Fft(Complex* data, bool inverse) const;
+    double Green(double dx, double dy, double spacing) const;
+
+    std::size_t m_nodes;            // Nodes per side of the mesh
+    std::size_t m_padded;           // Nodes per side of the zero padded grid (2 * m_nodes)
+
+    std::vector<Complex> m_twiddles;
+    std::vector<std::size_t> m_bitReverse;
+
+    std::vector<Complex> m_greens;  // Transformed Green's function
+    double m_greensSpacing;
+    double m_greensG;
+    double m_greensEps;
+
+    std::vector<Complex> m_grid;    // Mass, then potential on the padded grid
+    std::vector<Complex> m_columns; // A column of the padded grid per thread, for the column FFTs
+    std::vector<double> m_potential;
+    std::vector<double> m_gridAX;
+    std::vector<double> m_gridAY;
+};
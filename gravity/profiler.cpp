@@ -0,0 +1,109 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <iomanip>
+
+namespace
+{
+    const std::size_t MAX_TRACE_EVENTS = 1 << 20;
+}
+
+Profiler::Profiler() :
+        m_stats(),
+        m_allocations(0),
+        m_bTracing(false),
+        m_origin(Clock::now())
+{
+}
+
+const char* Profiler::PhaseName(Phase phase)
+{
+    switch (phase)
+    {
+        case Phase::Step:
+            return "step";
+        case Phase::Forces:
+            return "forces";
+        case Phase::Integration:
+            return "integration";
+        case Phase::Diagnostics:
+            return "diagnostics";
+        case Phase::Collisions:
+            return "collisions";
+        case Phase::Trails:
+            return "trails";
+        case Phase::Reorder:
+            return "reorder";
+        case Phase::Culling:
+            return "culling";
+        case Phase::Bindings:
+            return "bindings";
+        default:
+            return "unknown";
+    }
+}
+
+void Profiler::Record(Phase phase, Clock::time_point start, Clock::time_point end)
+{
+    const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+    PhaseStats& stats = m_stats[phase];
+    ++stats.Calls;
+    stats.TotalMs += ms;
+    stats.MaxMs = std::max(stats.MaxMs, ms);
+
+    if (m_bTracing && m_trace.size() < MAX_TRACE_EVENTS)
+    {
+        const double startUs = std::chrono::duration<double, std::micro>(start - m_origin).count();
+        m_trace.push_back({ phase, startUs, 1000.0 * ms });
+    }
+}
+
+const Profiler::PhaseStats& Profiler::Stats(Phase phase) const
+{
+    return m_stats[phase];
+}
+
+void Profiler::CountAllocation()
+{
+    ++m_allocations;
+}
+
+unsigned long long Profiler::Allocations() const
+{
+    return m_allocations;
+}
+
+void Profiler::Reset()
+{
+    std::fill(std::begin(m_stats), std::end(m_stats), PhaseStats());
+    m_allocations = 0;
+    m_trace.clear();
+}
+
+bool Profiler::Tracing() const
+{
+    return m_bTracing;
+}
+
+void Profiler::Tracing(bool enabled)
+{
+    m_bTracing = enabled;
+}
+
+void Profiler::WriteTrace(std::ostream& os) const
+{
+    // Complete ("X") events, which nest by time so the phases inside a step show under it
+    const std::ios::fmtflags flags = os.flags();
+    const std::streamsize precision = os.precision();
+    os << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+    for (std::size_t i = 0; i < m_trace.size(); ++i)
+    {
+        const TraceEvent& event = m_trace[i];
+        os << (i == 0 ? "\n" : ",\n")
+           << "{\"name\":\"" << PhaseName(event.EventPhase) << "\",\"cat\":\"gravity\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"
+           << "\"ts\":" << event.StartUs << ",\"dur\":" << event.DurationUs << "}";
+    }
+    os << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    os.flags(flags);
+    os.precision(precision);
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <chrono>
+#include <ostream>
+#include <vector>
+
+// Instrumentation is compiled in unless GRAVITY_PROFILING is 0 (-DGRAVITY_PROFILING=OFF in CMake), in which
+// case the GRAVITY_PROFILE_SCOPE timers compile to nothing and every phase reads as never having run
+#ifndef GRAVITY_PROFILING
+#define GRAVITY_PROFILING 1
+#endif
+
+// Per phase wall clock totals of the simulation, plus an optional trace of every timed span that can be
+// written as Chrome trace event JSON (load it in chrome://tracing or ui.perfetto.dev). Timers are only taken
+// on the thread calling into the simulation, work farmed out to the thread pool is inside its caller's span.
+class Profiler
+{
+public:
+    enum Phase
+    {
+        Step,           // The whole of Update()
+        Forces,         // Force passes (and the tree build they include)
+        Integration,    // Kicks, drifts and the Hermite predictor/corrector
+        Diagnostics,
+        Collisions,
+        Trails,
+        Reorder,        // Sorting the bodies along a Morton curve
+        Culling,        // Finding and culling escaping bodies
+        Bindings,       // Marshalling between JS and the engine
+        PhaseCount
+    };
+
+    struct PhaseStats
+    {
+        unsigned long long Calls;
+        double TotalMs;
+        double MaxMs;
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr bool Enabled = GRAVITY_PROFILING != 0;
+
+    Profiler();
+
+    static const char* PhaseName(Phase phase);
+
+    void Record(Phase phase, Clock::time_point start, Clock::time_point end);
+    const PhaseStats& Stats(Phase phase) const;
+
+    // Growths of the body storage
+    void CountAllocation();
+    unsigned long long Allocations() const;
+
+    // Clears the totals and any recorded trace
+    void Reset();
+
+    // While tracing every span is kept (up to a million, later ones are dropped) for WriteTrace
+    bool Tracing() const;
+    void Tracing(bool enabled);
+    void WriteTrace(std::ostream& os) const;
+
+private:
+    struct TraceEvent
+    {
+        Phase EventPhase;
+        double StartUs;     // Since the profiler was created
+        double DurationUs;
+    };
+
+    PhaseStats m_stats[PhaseCount];
+    unsigned long long m_allocations;
+    bool m_bTracing;
+    Clock::time_point m_origin;
+    std::vector<TraceEvent> m_trace;
+};
+
+// Records the lifetime of the scope against a phase
+class ScopedTimer
+{
+public:
+    ScopedTimer(Profiler& profiler, Profiler::Phase phase) :
+            m_profiler(profiler),
+            m_phase(phase),
+            m_start(Profiler::Clock::now())
+    {
+    }
+
+    ~ScopedTimer()
+    {
+        m_profiler.Record(m_phase, m_start, Profiler::Clock::now());
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Profiler& m_profiler;
+    Profiler::Phase m_phase;
+    Profiler::Clock::time_point m_start;
+};
+
+#if GRAVITY_PROFILING
+#define GRAVITY_PROFILE_SCOPE(profiler, phase) ScopedTimer profileScope((profiler), Profiler::Phase::phase)
+#define GRAVITY_COUNT_ALLOCATION(profiler) (profiler).CountAllocation()
+#else
+#define GRAVITY_PROFILE_SCOPE(profiler, phase) ((void)0)
+#define GRAVITY_COUNT_ALLOCATION(profiler) ((void)0)
+#endif
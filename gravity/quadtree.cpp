@@ -0,0 +1,176 @@
+#include "quadtree.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "force_law.hpp"
+
+namespace
+{
+    // Stops coincident bodies from subdividing forever, they just end up sharing a leaf
+    const unsigned int MAX_DEPTH = 48;
+}
+
+QuadTree::QuadTree() : m_pX(nullptr), m_pY(nullptr), m_pMass(nullptr)
+{
+}
+
+void QuadTree::Reserve(std::size_t count)
+{
+    // Trees of the built in scenarios have 0.35-0.4 nodes per body
+    m_nodes.reserve(count / 2 + 1);
+    m_order.reserve(count);
+}
+
+std::size_t QuadTree::MemoryBytes() const
+{
+    return m_nodes.capacity() * sizeof(Node) + m_order.capacity() * sizeof(unsigned int);
+}
+
+void QuadTree::Build(const double* x, const double* y, const double* mass, std::size_t count)
+{
+    m_pX = x;
+    m_pY = y;
+    m_pMass = mass;
+    m_nodes.clear();
+    m_order.resize(count);
+    if (count == 0)
+    {
+        return;
+    }
+
+    double minX = x[0], maxX = x[0], minY = y[0], maxY = y[0];
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        m_order[i] = static_cast<unsigned int>(i);
+        minX = std::min(minX, x[i]);
+        maxX = std::max(maxX, x[i]);
+        minY = std::min(minY, y[i]);
+        maxY = std::max(maxY, y[i]);
+    }
+
+    Node root;
+    root.MinX = minX;
+    root.MinY = minY;
+    // Pad slightly so bodies on the max edge fall inside the root square
+    root.Size = std::max(maxX - minX, maxY - minY) * 1.0001 + 1e-12;
+    root.Begin = 0;
+    root.End = static_cast<unsigned int>(count);
+    m_nodes.push_back(root);
+    BuildNode(0, 0);
+}
+
+void QuadTree::BuildNode(std::size_t nodeIndex, unsigned int depth)
+{
+    Node node = m_nodes[nodeIndex];
+
+    double mass = 0.0, comX = 0.0, comY = 0.0;
+    for (unsigned int i = node.Begin; i < node.End; ++i)
+    {
+        const unsigned int body = m_order[i];
+        mass += m_pMass[body];
+        comX += m_pMass[body] * m_pX[body];
+        comY += m_pMass[body] * m_pY[body];
+    }
+    node.Mass = mass;
+    node.ComX = mass != 0.0 ? comX / mass : node.MinX + 0.5 * node.Size;
+    node.ComY = mass != 0.0 ? comY / mass : node.MinY + 0.5 * node.Size;
+    node.FirstChild = -1;
+    node.ChildCount = 0;
+
+    if (node.End - node.Begin > LEAF_SIZE && depth < MAX_DEPTH)
+    {
+        // Partition the node's bodies into quadrants: [bottom left, bottom right, top left, top right]
+        const double half = 0.5 * node.Size;
+        const double midX = node.MinX + half;
+        const double midY = node.MinY + half;
+        auto first = m_order.begin() + node.Begin;
+        auto last = m_order.begin() + node.End;
+        auto splitY = std::partition(first, last, [&](unsigned int b) { return m_pY[b] < midY; });
+        auto splitBottom = std::partition(first, splitY, [&](unsigned int b) { return m_pX[b] < midX; });
+        auto splitTop = std::partition(splitY, last, [&](unsigned int b) { return m_pX[b] < midX; });
+
+        const decltype(first) bounds[5] = { first, splitBottom, splitY, splitTop, last };
+        node.FirstChild = static_cast<int>(m_nodes.size());
+        for (unsigned int q = 0; q < 4; ++q)
+        {
+            if (bounds[q] == bounds[q + 1])
+            {
+                continue;
+            }
+            Node child;
+            child.MinX = (q & 1) ? midX : node.MinX;
+            child.MinY = (q & 2) ? midY : node.MinY;
+            child.Size = half;
+            child.Begin = static_cast<unsigned int>(bounds[q] - m_order.begin());
+            child.End = static_cast<unsigned int>(bounds[q + 1] - m_order.begin());
+            m_nodes.push_back(child);
+            ++node.ChildCount;
+        }
+    }
+    m_nodes[nodeIndex] = node;
+
+    for (unsigned int c = 0; c < node.ChildCount; ++c)
+    {
+        BuildNode(node.FirstChild + c, depth + 1);
+    }
+}
+
+std::size_t QuadTree::Acceleration(double x, double y, std::size_t skip, double theta, double G, double eps,
+                                   double& ax, double& ay, double* potential) const
+{
+    if (m_nodes.empty())
+    {
+        return 0;
+    }
+
+    std::size_t interactions = 0;
+    const double theta2 = theta * theta;
+    int stack[4 * MAX_DEPTH + 4];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const Node& node = m_nodes[stack[--top]];
+        if (node.FirstChild < 0)
+        {
+            for (unsigned int i = node.Begin; i < node.End; ++i)
+            {
+                const unsigned int body = m_order[i];
+                if (body != skip)
+                {
+                    const double dx = m_pX[body] - x;
+                    const double dy = m_pY[body] - y;
+                    AccumulatePairAcceleration(dx, dy, m_pMass[body], G, eps, ax, ay);
+                    if (potential)
+                    {
+                        *potential += m_pMass[body] * std::log(dx*dx + dy*dy + eps);
+                    }
+                    ++interactions;
+                }
+            }
+            continue;
+        }
+
+        const double dx = node.ComX - x;
+        const double dy = node.ComY - y;
+        const bool inside = x >= node.MinX && x < node.MinX + node.Size && y >= node.MinY && y < node.MinY + node.Size;
+        if (!inside && node.Size * node.Size < theta2 * (dx*dx + dy*dy))
+        {
+            AccumulatePairAcceleration(dx, dy, node.Mass, G, eps, ax, ay);
+            if (potential)
+            {
+                *potential += node.Mass * std::log(dx*dx + dy*dy + eps);
+            }
+            ++interactions;
+        }
+        else
+        {
+            for (unsigned int c = 0; c < node.ChildCount; ++c)
+            {
+                stack[top++] = node.FirstChild + c;
+            }
+        }
+    }
+    return interactions;
+}
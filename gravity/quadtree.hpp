@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Barnes-Hut quadtree over a set of bodies. The tree is rebuilt from scratch from the body positions
+// whenever they change, each node stores the total mass and centre of mass of the bodies below it so that
+// distant groups of bodies can be approximated by a single pseudo-body.
+class QuadTree
+{
+public:
+    QuadTree();
+
+    // Bodies per leaf, leaves are summed directly
+    static const unsigned int LEAF_SIZE = 8;
+
+    void Build(const double* x, const double* y, const double* mass, std::size_t count);
+
+    // Accumulates the acceleration at (x, y) due to every body in the tree except the body at index skip.
+    // A node is approximated by its centre of mass when size / distance < theta. Returns the number of
+    // body-body or body-node interactions evaluated. If potential is not null, the sum of m*ln(r^2 + eps)
+    // over the same sources is added to it.
+    std::size_t Acceleration(double x, double y, std::size_t skip, double theta, double G, double eps,
+                             double& ax, double& ay, double* potential = nullptr) const;
+
+    std::size_t NodeCount() const { return m_nodes.size(); };
+
+    // Sizes the node and order arrays for count bodies so builds up to that size don't reallocate (for
+    // typical distributions, strongly clustered ones can still need more nodes)
+    void Reserve(std::size_t count);
+    std::size_t MemoryBytes() const;
+
+private:
+    struct Node
+    {
+        double MinX;
+        double MinY;
+        double Size;
+        double Mass;
+        double ComX;
+        double ComY;
+        unsigned int Begin;      // Range of the bodies in this node in m_order
+        unsigned int End;
+        int FirstChild;          // Children are stored contiguously, -1 for a leaf
+        unsigned int ChildCount;
+    };
+
+    void BuildNode(std::size_t nodeIndex, unsigned int depth);
+
+    std::vector<Node> m_nodes;
+    std::vector<unsigned int> m_order;
+    const double* m_pX;
+    const double* m_pY;
+    const double* m_pMass;
+};
@@ -1,7 +1,65 @@
 ﻿#include "simulation.hpp"
 
-Simulation::Simulation() : m_nextId(0), m_dt(0.001)
+#include <algorithm>
+#include <cmath>
+
+#include "force_kernel.hpp"
+#include "force_law.hpp"
+#include "morton_order.hpp"
+
+Simulation::Simulation(IntegrationMethod integrator) :
+        m_gravConst(GCONST),
+        m_bPaused(false),
+        m_bDrawVelVectors(false),
+        m_soften(false),
+        m_dt(0.001),
+        m_integrator(integrator),
+        m_integrate(nullptr),
+        m_solver(ForceSolver::DirectSum),
+        m_precision(ForcePrecision::Double),
+        m_theta(0.5),
+        m_interactionCount(0),
+        m_bAccelerationsValid(false),
+        m_stepCount(0),
+        m_time(0.0),
+        m_pendingTime(0.0),
+        m_diagnosticsInterval(0),
+        m_diagnostics(),
+        m_bBlockTimesteps(false),
+        m_maxTimestepLevel(6),
+        m_timestepAccuracy(0.02),
+        m_bCollisions(false),
+        m_mergeCount(0),
+        m_trailInterval(1),
+        m_reorderInterval(0),
+        m_cullPolicy(CullPolicy::Keep),
+        m_reservedBodies(0),
+        m_nextId(0),
+        m_staticCount(0),
+        m_bStaticFieldValid(false)
 {
+    switch (integrator)
+    {
+        case IntegrationMethod::Euler:
+            m_integrate = &Simulation::Integrate<EulerIntegrator>;
+            break;
+        case IntegrationMethod::Taylor:
+            m_integrate = &Simulation::Integrate<TaylorIntegrator>;
+            break;
+        case IntegrationMethod::Yoshida:
+            m_integrate = &Simulation::Integrate<YoshidaIntegrator>;
+            break;
+        case IntegrationMethod::Omelyan:
+            m_integrate = &Simulation::Integrate<OmelyanIntegrator>;
+            break;
+        case IntegrationMethod::Hermite:
+            m_integrate = &Simulation::Integrate<HermiteIntegrator>;
+            break;
+        default:
+            m_integrator = IntegrationMethod::Leapfrog;
+            m_integrate = &Simulation::Integrate<LeapfrogIntegrator>;
+            break;
+    }
     InitSimBounds();
 }
 
@@ -20,222 +78,1803 @@ void Simulation::SetSimBounds(double xMin, double xMax, double yMin, double yMax
     m_simBounds.x_axis.Max = xMax;
     m_simBounds.y_axis.Min = yMin;
     m_simBounds.y_axis.Max = yMax;
+    m_bAccelerationsValid = false;
+    m_bStaticFieldValid = false;
 }
 
-void Simulation::AddBody(Body& body)
+const SimulationBounds2D& Simulation::SimBounds() const
 {
-    m_bodies.push_back(body);
+    return m_simBounds;
+}
+
+void Simulation::MeshRegion(double& minX, double& minY, double& size) const
+{
+    // Square about the centre of the simulation bounds, doubled until every body is at least a cell inside
+    // it. Doubling rather than fitting the bodies keeps the cell size (and the cached Green's function)
+    // the same from step to step.
+    const double centreX = 0.5 * (m_simBounds.x_axis.Min + m_simBounds.x_axis.Max);
+    const double centreY = 0.5 * (m_simBounds.y_axis.Min + m_simBounds.y_axis.Max);
+    size = std::max(m_simBounds.x_axis.Max - m_simBounds.x_axis.Min, m_simBounds.y_axis.Max - m_simBounds.y_axis.Min);
+    if (!(size > 0.0))
+    {
+        size = 1.0;
+    }
+
+    // Only the dynamic bodies go on the mesh
+    double extent = 0.0;
+    for (std::size_t i = 0; i < DynamicCount(); ++i)
+    {
+        extent = std::max(extent, std::max(std::abs(m_bodies.X[i] - centreX), std::abs(m_bodies.Y[i] - centreY)));
+    }
+    const double cells = static_cast<double>(m_mesh.GridSize() - 1);
+    while (0.5 * size * (1.0 - 2.0 / cells) < extent && std::isfinite(extent))
+    {
+        size *= 2.0;
+    }
+
+    minX = centreX - 0.5 * size;
+    minY = centreY - 0.5 * size;
 }
 
-void Simulation::AddBody(double mass, double radius, bool isStatic)
+unsigned int Simulation::AddBody(double mass, double radius, bool isStatic)
 {
-    Body newBody(m_nextId++, mass, radius);
-    newBody.Static(isStatic);
-    AddBody(newBody);
+    return AddBody(mass, radius, Vector2(), Vector2(), Vector3(), isStatic);
 }
 
-void Simulation::AddBody(double mass, double radius, Vector2 position, bool isStatic)
+unsigned int Simulation::AddBody(double mass, double radius, Vector2 position, bool isStatic)
 {
-    Body newBody(m_nextId++, mass, radius);
-    newBody.Position(position);
-    newBody.Static(isStatic);
-    AddBody(newBody);
+    return AddBody(mass, radius, position, Vector2(), Vector3(), isStatic);
 }
 
-void Simulation::AddBody(double mass, double radius, Vector2 position, Vector2 velocity, bool isStatic)
+unsigned int Simulation::AddBody(double mass, double radius, Vector2 position, Vector2 velocity, bool isStatic)
 {
-    Body newBody(m_nextId++, mass, radius);
-    newBody.Position(position);
-    newBody.Velocity(velocity);
-    newBody.Static(isStatic);
-    AddBody(newBody);
+    return AddBody(mass, radius, position, velocity, Vector3(), isStatic);
 }
 
-void Simulation::AddBody(double mass, double radius, Vector2 position, Vector2 velocity, Vector3 colour, bool isStatic)
+unsigned int Simulation::AddBody(double mass, double radius, Vector2 position, Vector2 velocity, Vector3 colour, bool isStatic)
 {
-    Body newBody(m_nextId++, mass, radius);
-    newBody.Position(position);
-    newBody.Velocity(velocity);
-    newBody.Colour(colour);
-    newBody.Static(isStatic);
-    AddBody(newBody);
+    const std::size_t capacity = m_bodies.Mass.capacity();
+    const unsigned int id = m_nextId++;
+    m_bodies.Add(id, mass, radius, position, velocity, colour, isStatic);
+    if (m_bodies.Mass.capacity() != capacity)
+    {
+        GRAVITY_COUNT_ALLOCATION(m_profiler);
+    }
+    m_trails.Append(m_bodies.X.data(), m_bodies.Y.data(), m_bodies.Size());
+    PartitionStatic(m_bodies.Size() - 1);
+    m_bAccelerationsValid = false;
+    return id;
 }
 
-void Simulation::AddBodies(std::vector<Body> bodies)
+void Simulation::AddBodies(const std::vector<Body>& bodies)
 {
+    m_bodies.Reserve(m_bodies.Size() + bodies.size());
     for (auto& body : bodies)
     {
-        AddBody(body);
+        AddBody(body.Mass(), body.Radius(), body.Position(), body.Velocity(), body.Colour(), body.Static());
+    }
+}
+
+unsigned int Simulation::AddBodies(std::size_t count, const double* mass, const double* radius, const double* x,
+                                   const double* y, const double* vx, const double* vy, bool isStatic)
+{
+    const std::size_t capacity = m_bodies.Mass.capacity();
+    const unsigned int firstId = m_nextId;
+    m_bodies.Append(count, firstId, mass, radius, x, y, vx, vy, isStatic);
+    if (m_bodies.Mass.capacity() != capacity)
+    {
+        GRAVITY_COUNT_ALLOCATION(m_profiler);
     }
+    m_nextId += static_cast<unsigned int>(count);
+    m_trails.Append(m_bodies.X.data(), m_bodies.Y.data(), m_bodies.Size());
+    PartitionStatic(m_bodies.Size() - count);
+    m_bAccelerationsValid = false;
+    return firstId;
 }
 
 int Simulation::BodyCount() const
 {
-    return m_bodies.size();
+    return m_bodies.Size();
+}
+
+std::size_t Simulation::StaticCount() const
+{
+    return m_staticCount;
+}
+
+std::size_t Simulation::DynamicCount() const
+{
+    return m_bodies.Size() - m_staticCount;
 }
 
-Vector2 Simulation::CalculateTotalForceOnBody(const Body& body, bool soften)
+void Simulation::SwapBodies(std::size_t i, std::size_t j)
 {
-    Vector2 force_agg;
-    for (auto forceFromBody : m_bodies)
+    m_bodies.Swap(i, j);
+    m_trails.Swap(i, j);
+    if (m_jerkX.size() > std::max(i, j))
     {
-        // Only add force contributions of other bodies, not itself
-        if (body.Id() != forceFromBody.Id())
+        std::swap(m_jerkX[i], m_jerkX[j]);
+        std::swap(m_jerkY[i], m_jerkY[j]);
+    }
+}
+
+bool Simulation::RemoveBody(unsigned int id)
+{
+    const std::size_t index = m_bodies.IndexOf(id);
+    if (index == BodyStore::NO_INDEX)
+    {
+        return false;
+    }
+    RemoveAt(index);
+    return true;
+}
+
+void Simulation::RemoveAt(std::size_t index)
+{
+    // A dynamic body is first swapped to the end of the dynamic bodies. Swapping that slot with the last body
+    // then moves the last static body into it, which becomes the first static body once the store shrinks.
+    if (m_bodies.Static[index])
+    {
+        --m_staticCount;
+        if (m_bodies.Mass[index] != 0.0)
         {
-            // Calculate the contribution of the force between the two bodies
-            force_agg += body.ForceExertedBy(forceFromBody, G(), soften);
+            m_bStaticFieldValid = false;
         }
     }
-    return force_agg;
+    else
+    {
+        const std::size_t lastDynamic = DynamicCount() - 1;
+        SwapBodies(index, lastDynamic);
+        index = lastDynamic;
+    }
+    const std::size_t last = m_bodies.Size() - 1;
+    SwapBodies(index, last);
+    if (m_jerkX.size() == m_bodies.Size())
+    {
+        m_jerkX.pop_back();
+        m_jerkY.pop_back();
+    }
+    m_trails.PopBack();
+    m_bodies.PopBack();
+    m_bAccelerationsValid = false;
 }
 
-void Simulation::Update()
+void Simulation::PartitionStatic(std::size_t first)
 {
-    // Don't do anything if we are paused
-    if (m_bPaused) return;
-
-    auto intMethod = IntegrationMethod::Leapfrog;
+    // Bodies before first are already partitioned. Each dynamic body from there on is swapped with the first
+    // static body, which keeps the dynamic bodies in order but not the static ones.
+    std::size_t dynamicEnd = first - m_staticCount;
+    for (std::size_t i = first; i < m_bodies.Size(); ++i)
+    {
+        if (m_bodies.Static[i])
+        {
+            ++m_staticCount;
+            m_bStaticFieldValid = false;
+            continue;
+        }
+        if (i != dynamicEnd)
+        {
+            SwapBodies(i, dynamicEnd);
+        }
+        ++dynamicEnd;
+    }
+}
 
-    Vector2 force_agg, new_force_agg;
-    if (m_bodies.size() > 0)
+void Simulation::PrepareStaticField()
+{
+    if (m_bStaticFieldValid)
+    {
+        return;
+    }
+    // Any grid covers the simulation bounds, widened to take in all of the static bodies with mass (not frozen
+    // ones, see CullPolicy)
+    const std::size_t first = DynamicCount();
+    double minX = m_simBounds.x_axis.Min;
+    double maxX = m_simBounds.x_axis.Max;
+    double minY = m_simBounds.y_axis.Min;
+    double maxY = m_simBounds.y_axis.Max;
+    for (std::size_t i = first; i < m_bodies.Size(); ++i)
     {
-        // Loop over each body to calculate new position
-        for (auto& body : m_bodies)
+        if (m_bodies.Mass[i] == 0.0)
         {
-            // Only calculate new position if body is not statics
-            if (!body.Static())
-            {
-                Vector2 new_vel, new_pos;
-                Vector2 temp_vel, temp_pos;
+            continue;
+        }
+        minX = std::min(minX, m_bodies.X[i]);
+        maxX = std::max(maxX, m_bodies.X[i]);
+        minY = std::min(minY, m_bodies.Y[i]);
+        maxY = std::max(maxY, m_bodies.Y[i]);
+    }
+    m_staticField.Build(m_bodies.X.data() + first, m_bodies.Y.data() + first, m_bodies.Mass.data() + first,
+                        m_staticCount, m_gravConst, m_soften ? SOFTENING : 0.0, minX, minY, maxX, maxY, m_threadPool);
+    m_bStaticFieldValid = true;
+}
 
-                double dt = m_dt;
+double Simulation::AddStaticField(bool withPotential)
+{
+    PrepareStaticField();
+    const std::size_t count = DynamicCount();
+    std::fill(m_bodies.AX.begin() + count, m_bodies.AX.end(), 0.0);
+    std::fill(m_bodies.AY.begin() + count, m_bodies.AY.end(), 0.0);
 
-                switch (intMethod)
-                {
-                    case IntegrationMethod::Euler:
-                        // Euler
-                        // v_n+1 = v_n + sum(F)*dt
-                        // p_n+1 = p_n + v_n+1 *dt
-                        force_agg = CalculateTotalForceOnBody(body, m_soften);
-                        new_vel = body.Velocity() + force_agg*dt;
-                        new_pos = body.Position() + new_vel*dt;
-                        body.Acceleration(force_agg);
-                        body.Velocity(new_vel);
-                        body.Position(new_pos);
-                        break;
-                    case IntegrationMethod::Taylor:
-                        // Taylor Series
-                        // v_n+1 = v_n + sum(F)*dt
-                        // p_n+1 = p_n + v_n+1 *dt + 0.5*sum(F)*dt*dt
-                        force_agg = CalculateTotalForceOnBody(body, m_soften);
-                        new_vel = body.Velocity() + force_agg*dt;
-                        new_pos = body.Position() + new_vel*dt + 0.5*force_agg*dt*dt;
-                        body.Acceleration(force_agg);
-                        body.Velocity(new_vel);
-                        body.Position(new_pos);
-                        break;
-                    case IntegrationMethod::Leapfrog:
-                        // Leapfrog
-                        // r_n+0.5 = r_n + 0.5*dt*v_n
-                        // v_n+1 = v_n + dt*a(r_n+0.5)
-                        // r_n+1 = r_n+0.5 + 0.5*dt*v_n+1
-                        temp_pos = body.Position() + dt*0.5*body.Velocity();
-                        body.Position(temp_pos);
-                        force_agg = CalculateTotalForceOnBody(body, m_soften);
-                        new_vel = body.Velocity() + dt*force_agg;
-                        new_pos = temp_pos + 0.5*dt*new_vel;
-                        body.Velocity(new_vel);
-                        body.Position(new_pos);
-                        break;
-                        // Improved Euler
-                        // a_n = sum(F(p_n))
-                        // p_temp = p_n + v_n * dt
-                        // a_temp = sum(F(p_temp))
-                        // v_n+1 = v_n + 0.5 * (a_n + a_temp) * dt
-                        // p_n+1 = p_n + 0.5 * (v_n+1 + v_n) * dt
-                }
+    double potential = 0.0;
+    std::mutex potentialMutex;
+    m_threadPool.ParallelFor(count, 0, [&](std::size_t begin, std::size_t end)
+    {
+        double chunkPotential = 0.0;
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            m_staticField.AddAcceleration(m_bodies.X[i], m_bodies.Y[i], m_bodies.AX[i], m_bodies.AY[i]);
+            if (withPotential)
+            {
+                chunkPotential += m_bodies.Mass[i] * m_staticField.Potential(m_bodies.X[i], m_bodies.Y[i]);
             }
         }
+        if (withPotential)
+        {
+            std::lock_guard<std::mutex> lock(potentialMutex);
+            potential += chunkPotential;
+        }
+    });
+    m_interactionCount += count * (m_staticField.Gridded() ? 1 : m_staticField.Count());
+    return withPotential ? potential + m_staticField.SelfPotential() : 0.0;
+}
+
+void Simulation::AddStaticField(const std::vector<std::size_t>& targets, double* ax, double* ay)
+{
+    PrepareStaticField();
+    m_threadPool.ParallelFor(targets.size(), 0, [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t k = begin; k < end; ++k)
+        {
+            m_staticField.AddAcceleration(m_bodies.X[targets[k]], m_bodies.Y[targets[k]], ax[k], ay[k]);
+        }
+    });
+    m_interactionCount += targets.size() * (m_staticField.Gridded() ? 1 : m_staticField.Count());
+}
+
+unsigned int Simulation::StaticFieldGrid() const
+{
+    return m_staticField.GridSize();
+}
+
+void Simulation::StaticFieldGrid(unsigned int nodes)
+{
+    m_staticField.GridSize(nodes);
+    m_bStaticFieldValid = false;
+    m_bAccelerationsValid = false;
+}
+
+void Simulation::Reserve(std::size_t maxBodies)
+{
+    m_reservedBodies = std::max(m_reservedBodies, maxBodies);
+    const std::size_t capacity = m_bodies.Mass.capacity();
+    m_bodies.Reserve(m_reservedBodies);
+    if (m_bodies.Mass.capacity() != capacity)
+    {
+        GRAVITY_COUNT_ALLOCATION(m_profiler);
     }
+    ReserveScratch();
 }
 
-void Simulation::Reset()
+void Simulation::ReserveScratch()
 {
-    for (auto& body : m_bodies)
+    const std::size_t count = m_reservedBodies;
+    if (count == 0)
+    {
+        return;
+    }
+    m_trails.Reserve(count);
+    if (m_solver == ForceSolver::BarnesHut)
+    {
+        m_tree.Reserve(count);
+    }
+    if (m_solver == ForceSolver::ParticleMesh)
+    {
+        m_mesh.Reserve(m_threadPool.ThreadCount());
+    }
+    if (m_solver == ForceSolver::DirectSum && m_precision == ForcePrecision::Mixed)
+    {
+        m_floatX.reserve(count);
+        m_floatY.reserve(count);
+        m_floatMass.reserve(count);
+        m_floatAX.reserve(count);
+        m_floatAY.reserve(count);
+    }
+    if (m_bBlockTimesteps)
+    {
+        m_active.reserve(count);
+        m_activeAX.reserve(count);
+        m_activeAY.reserve(count);
+        m_previousAX.reserve(count);
+        m_previousAY.reserve(count);
+        if (m_solver == ForceSolver::ParticleMesh)
+        {
+            m_meshAX.reserve(count);
+            m_meshAY.reserve(count);
+        }
+    }
+    if (m_integrator == IntegrationMethod::Hermite)
+    {
+        for (std::vector<double>* column : { &m_jerkX, &m_jerkY, &m_startX, &m_startY, &m_startVX, &m_startVY,
+                                             &m_startAX, &m_startAY, &m_startJerkX, &m_startJerkY })
+        {
+            column->reserve(count);
+        }
+    }
+    if (m_reorderInterval > 0)
+    {
+        m_reorder.reserve(count);
+        m_reorderKeys.reserve(2 * count);
+        // Room for the widest column, see BodyStore::Permute, or the trails if they are wider
+        m_reorderScratch.reserve(count * std::max(sizeof(Vector3), 2 * m_trails.Capacity() * sizeof(double)));
+    }
+    if (m_bCollisions)
     {
-        body.Position(body.InitialPosition());
-        body.Velocity(body.InitialVelocity());
+        m_collisionGrid.Reserve(count);
+        // Even a crowded start that merges most bodies in its first step finds fewer contacts than this
+        m_contacts.reserve(count / 2);
+        m_mergeGroup.reserve(count);
+        m_removed.reserve(count);
     }
 }
 
-void Simulation::Pause()
+std::size_t Simulation::ReservedBodies() const
 {
-    m_bPaused = !m_bPaused;
+    return m_reservedBodies;
 }
 
-bool Simulation::IsPaused()
+SimulationMemory Simulation::MemoryUsage() const
 {
-    return m_bPaused;
+    SimulationMemory memory;
+    memory.Bodies = m_bodies.MemoryBytes();
+    memory.Trails = m_trails.MemoryBytes();
+
+    std::size_t scratch = m_tree.MemoryBytes() + m_mesh.MemoryBytes() + m_collisionGrid.MemoryBytes() +
+                          m_staticField.MemoryBytes();
+    scratch += m_contacts.capacity() * sizeof(m_contacts[0]);
+    scratch += (m_mergeGroup.capacity() + m_active.capacity() + m_reorder.capacity()) * sizeof(std::size_t);
+    scratch += m_reorderKeys.capacity() * sizeof(unsigned long long);
+    scratch += m_removed.capacity() + m_reorderScratch.capacity();
+    for (const std::vector<double>* column : { &m_activeAX, &m_activeAY, &m_previousAX, &m_previousAY, &m_meshAX,
+                                               &m_meshAY, &m_jerkX, &m_jerkY, &m_startX, &m_startY, &m_startVX,
+                                               &m_startVY, &m_startAX, &m_startAY, &m_startJerkX, &m_startJerkY })
+    {
+        scratch += column->capacity() * sizeof(double);
+    }
+    for (const std::vector<float>* column : { &m_floatX, &m_floatY, &m_floatMass, &m_floatAX, &m_floatAY })
+    {
+        scratch += column->capacity() * sizeof(float);
+    }
+    memory.Scratch = scratch;
+    memory.Total = memory.Bodies + memory.Scratch + memory.Trails;
+    return memory;
 }
 
-double Simulation::G() const
+void Simulation::BuildForceSolver()
 {
-    return m_gravConst;
+    if (m_solver == ForceSolver::BarnesHut)
+    {
+        m_tree.Build(m_bodies.X.data(), m_bodies.Y.data(), m_bodies.Mass.data(), DynamicCount());
+    }
 }
 
-void Simulation::G(double g)
+Vector2 Simulation::CalculateTotalForceOnBody(std::size_t index, bool soften)
 {
-    m_gravConst = g;
+    const double eps = soften ? SOFTENING : 0.0;
+    const double x = m_bodies.X[index];
+    const double y = m_bodies.Y[index];
+
+    double ax = 0.0;
+    double ay = 0.0;
+    if (m_solver == ForceSolver::BarnesHut)
+    {
+        // The tree only holds the dynamic bodies, the static ones are summed exactly
+        m_interactionCount += m_tree.Acceleration(x, y, index, m_theta, m_gravConst, eps, ax, ay);
+        for (std::size_t j = DynamicCount(); j < m_bodies.Size(); ++j)
+        {
+            if (j != index)
+            {
+                AccumulatePairAcceleration(m_bodies.X[j] - x, m_bodies.Y[j] - y, m_bodies.Mass[j], m_gravConst, eps, ax, ay);
+            }
+        }
+        m_interactionCount += m_staticCount;
+        return Vector2(ax, ay);
+    }
+
+    const double* pX = m_bodies.X.data();
+    const double* pY = m_bodies.Y.data();
+    const double* pMass = m_bodies.Mass.data();
+    for (std::size_t j = 0; j < m_bodies.Size(); ++j)
+    {
+        // Only add force contributions of other bodies, not itself
+        if (j != index)
+        {
+            AccumulatePairAcceleration(pX[j] - x, pY[j] - y, pMass[j], m_gravConst, eps, ax, ay);
+        }
+    }
+    m_interactionCount += m_bodies.Size() - 1;
+    return Vector2(ax, ay);
 }
 
-void Simulation::G(double massScale, double timeScale, double lengthScale)
+void Simulation::ComputeAccelerations(bool withPotential)
 {
-    m_gravConst = (GCONST * massScale * timeScale * timeScale) / (lengthScale * lengthScale * lengthScale);
+    GRAVITY_PROFILE_SCOPE(m_profiler, Forces);
+    const double eps = m_soften ? SOFTENING : 0.0;
+    // The solvers only see the dynamic bodies, the static ones' field is added afterwards
+    const std::size_t count = DynamicCount();
+    const double* pX = m_bodies.X.data();
+    const double* pY = m_bodies.Y.data();
+    const double* pMass = m_bodies.Mass.data();
+    double* pAX = m_bodies.AX.data();
+    double* pAY = m_bodies.AY.data();
+    const double G = m_gravConst;
+    double potential = 0.0;
+    std::mutex potentialMutex;
+
+    switch (m_solver)
+    {
+        case ForceSolver::DirectSum:
+            if (m_precision == ForcePrecision::Mixed)
+            {
+                potential = MixedPrecisionDirectSum(withPotential);
+            }
+            else if (m_threadPool.ThreadCount() > 1)
+            {
+                // Split by target body, each thread does full rows so no two threads write the same body
+                m_threadPool.ParallelFor(count, 0, [&](std::size_t begin, std::size_t end)
+                {
+                    double chunkPotential = 0.0;
+                    DirectSumAccelerationsRange(pX, pY, pMass, count, begin, end, G, eps, pAX, pAY,
+                                                withPotential ? &chunkPotential : nullptr);
+                    if (withPotential)
+                    {
+                        std::lock_guard<std::mutex> lock(potentialMutex);
+                        potential += chunkPotential;
+                    }
+                });
+            }
+            else
+            {
+                DirectSumAccelerations(pX, pY, pMass, count, G, eps, pAX, pAY, withPotential ? &potential : nullptr);
+            }
+            m_interactionCount += count > 0 ? count * (count - 1) : 0;
+            break;
+        case ForceSolver::BarnesHut:
+        {
+            BuildForceSolver();
+            std::atomic<unsigned long long> interactions(0);
+            m_threadPool.ParallelFor(count, 0, [&](std::size_t begin, std::size_t end)
+            {
+                unsigned long long chunkInteractions = 0;
+                double chunkPotential = 0.0;
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    double ax = 0.0;
+                    double ay = 0.0;
+                    double bodyPotential = 0.0;
+                    chunkInteractions += m_tree.Acceleration(pX[i], pY[i], i, m_theta, G, eps, ax, ay,
+                                                             withPotential ? &bodyPotential : nullptr);
+                    pAX[i] = ax;
+                    pAY[i] = ay;
+                    // Each pair is seen from both ends, so each end carries half of the pair potential
+                    chunkPotential += 0.25 * G * pMass[i] * bodyPotential;
+                }
+                interactions += chunkInteractions;
+                if (withPotential)
+                {
+                    std::lock_guard<std::mutex> lock(potentialMutex);
+                    potential += chunkPotential;
+                }
+            });
+            m_interactionCount += interactions;
+            break;
+        }
+        case ForceSolver::ParticleMesh:
+        {
+            double minX, minY, size;
+            MeshRegion(minX, minY, size);
+            m_mesh.Accelerations(pX, pY, pMass, count, G, eps, minX, minY, size, pAX, pAY,
+                                 withPotential ? &potential : nullptr, m_threadPool);
+            // One deposit and one interpolation per body
+            m_interactionCount += count;
+            break;
+        }
+    }
+
+    if (m_staticCount > 0)
+    {
+        potential += AddStaticField(withPotential);
+    }
+    if (withPotential)
+    {
+        m_diagnostics.PotentialEnergy = potential;
+    }
+    m_bAccelerationsValid = true;
 }
 
-double Simulation::Energy() const
+double Simulation::MixedPrecisionDirectSum(bool withPotential)
 {
-    // E = 0.5 * sum{i=1..N}(m_i v_i^2) + sum{i=1..N}(sum{j!=i}(Gm_im_j/|r_i - r_j|))
-    double energy = 0.0;
-    for (auto& body : m_bodies)
+    const std::size_t count = DynamicCount();
+    const double G = m_gravConst;
+    if (count == 0 || G == 0.0)
     {
-        energy += 0.5*body.Mass()*body.Velocity().NormSquared(); // Kinetic energy
-        // Get all bodies with
-        for (auto& potentialBody : m_bodies)
+        std::fill(m_bodies.AX.begin(), m_bodies.AX.end(), 0.0);
+        std::fill(m_bodies.AY.begin(), m_bodies.AY.end(), 0.0);
+        return 0.0;
+    }
+
+    // Positions relative to their mean so the float separations keep as many bits as possible, and G folded
+    // into the masses so a small G (e.g. SI units) can't underflow
+    double originX = 0.0;
+    double originY = 0.0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        originX += m_bodies.X[i];
+        originY += m_bodies.Y[i];
+    }
+    originX /= count;
+    originY /= count;
+
+    m_floatX.resize(count);
+    m_floatY.resize(count);
+    m_floatMass.resize(count);
+    m_floatAX.resize(count);
+    m_floatAY.resize(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        m_floatX[i] = static_cast<float>(m_bodies.X[i] - originX);
+        m_floatY[i] = static_cast<float>(m_bodies.Y[i] - originY);
+        m_floatMass[i] = static_cast<float>(G * m_bodies.Mass[i]);
+    }
+
+    const float eps = static_cast<float>(m_soften ? SOFTENING : 0.0);
+    const float* pX = m_floatX.data();
+    const float* pY = m_floatY.data();
+    const float* pMass = m_floatMass.data();
+    float* pAX = m_floatAX.data();
+    float* pAY = m_floatAY.data();
+    double potential = 0.0;
+    if (m_threadPool.ThreadCount() > 1)
+    {
+        std::mutex potentialMutex;
+        m_threadPool.ParallelFor(count, 0, [&](std::size_t begin, std::size_t end)
+        {
+            double chunkPotential = 0.0;
+            DirectSumAccelerationsRangeFloat(pX, pY, pMass, count, begin, end, 1.0f, eps, pAX, pAY,
+                                             withPotential ? &chunkPotential : nullptr);
+            if (withPotential)
+            {
+                std::lock_guard<std::mutex> lock(potentialMutex);
+                potential += chunkPotential;
+            }
+        });
+    }
+    else
+    {
+        DirectSumAccelerationsFloat(pX, pY, pMass, count, 1.0f, eps, pAX, pAY, withPotential ? &potential : nullptr);
+    }
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        m_bodies.AX[i] = pAX[i];
+        m_bodies.AY[i] = pAY[i];
+    }
+
+    // With G folded into both masses the pair potentials carry G^2
+    return potential / G;
+}
+
+void Simulation::ComputeAccelerations(const std::vector<std::size_t>& targets, double* ax, double* ay)
+{
+    GRAVITY_PROFILE_SCOPE(m_profiler, Forces);
+    const double eps = m_soften ? SOFTENING : 0.0;
+    const std::size_t count = DynamicCount();
+    const std::size_t targetCount = targets.size();
+    const double* pX = m_bodies.X.data();
+    const double* pY = m_bodies.Y.data();
+    const double* pMass = m_bodies.Mass.data();
+    const double G = m_gravConst;
+
+    switch (m_solver)
+    {
+        case ForceSolver::DirectSum:
+            m_threadPool.ParallelFor(targetCount, 0, [&](std::size_t begin, std::size_t end)
+            {
+                DirectSumAccelerationsTargets(pX, pY, pMass, count, targets.data() + begin, end - begin, G, eps,
+                                              ax + begin, ay + begin);
+            });
+            m_interactionCount += targetCount * (count - 1);
+            break;
+        case ForceSolver::BarnesHut:
+        {
+            // The tree is rebuilt because every body has drifted since the last force pass
+            BuildForceSolver();
+            std::atomic<unsigned long long> interactions(0);
+            m_threadPool.ParallelFor(targetCount, 0, [&](std::size_t begin, std::size_t end)
+            {
+                unsigned long long chunkInteractions = 0;
+                for (std::size_t k = begin; k < end; ++k)
+                {
+                    const std::size_t i = targets[k];
+                    ax[k] = 0.0;
+                    ay[k] = 0.0;
+                    chunkInteractions += m_tree.Acceleration(pX[i], pY[i], i, m_theta, G, eps, ax[k], ay[k]);
+                }
+                interactions += chunkInteractions;
+            });
+            m_interactionCount += interactions;
+            break;
+        }
+        case ForceSolver::ParticleMesh:
         {
-            if (body.Id() != potentialBody.Id())
+            // The mesh gives every body's acceleration for the same cost, keep the targets' only
+            m_meshAX.resize(count);
+            m_meshAY.resize(count);
+            double minX, minY, size;
+            MeshRegion(minX, minY, size);
+            m_mesh.Accelerations(pX, pY, pMass, count, G, eps, minX, minY, size, m_meshAX.data(), m_meshAY.data(),
+                                 nullptr, m_threadPool);
+            for (std::size_t k = 0; k < targetCount; ++k)
             {
-                energy -= body.GravitationalPotential(potentialBody, m_gravConst);
+                ax[k] = m_meshAX[targets[k]];
+                ay[k] = m_meshAY[targets[k]];
             }
+            m_interactionCount += count;
+            break;
         }
     }
-    return energy;
+
+    if (m_staticCount > 0)
+    {
+        AddStaticField(targets, ax, ay);
+    }
 }
 
-Vector2 Simulation::AngularMomentum() const
+unsigned int Simulation::TimestepLevel(double timescale) const
 {
-    // J = sum{i=1..N}(r_i cross m_i v_i)
-    return Vector2();
+    // Smallest k with dt/2^k <= eta*timescale
+    const double step = m_timestepAccuracy * timescale;
+    unsigned int level = 0;
+    double levelStep = m_dt;
+    while (level < m_maxTimestepLevel && !(levelStep <= step))
+    {
+        levelStep *= 0.5;
+        ++level;
+    }
+    return level;
 }
 
-const std::vector<Body>& Simulation::Bodies() const
+void Simulation::InitTimestepLevels()
 {
-    return m_bodies;
+    // There is no jerk estimate yet, use the time for the acceleration to change the velocity instead
+    for (std::size_t i = 0; i < m_bodies.Size(); ++i)
+    {
+        const double a = std::sqrt(m_bodies.AX[i]*m_bodies.AX[i] + m_bodies.AY[i]*m_bodies.AY[i]);
+        const double v = std::sqrt(m_bodies.VX[i]*m_bodies.VX[i] + m_bodies.VY[i]*m_bodies.VY[i]);
+        m_bodies.TimestepLevel[i] = static_cast<unsigned char>(a > 0.0 ? TimestepLevel(v / a) : 0);
+    }
 }
 
-void Simulation::soften(bool value)
+void Simulation::BlockStep(bool diagnose)
 {
-    m_soften = value;
+    // Time is counted in ticks of the shortest step, a body on level k steps 2^(levels - k) ticks at a
+    // time and its steps always start on a multiple of that, so all bodies are synchronised at the end
+    const unsigned int levels = m_maxTimestepLevel;
+    const unsigned long long ticks = 1ull << levels;
+    const double tick = m_dt / static_cast<double>(ticks);
+    const std::size_t count = m_bodies.Size();
+    unsigned char* level = m_bodies.TimestepLevel.data();
+
+    unsigned long long now = 0;
+    while (now < ticks)
+    {
+        // Opening half kick for the bodies starting a step, then drift everything to the end of the
+        // shortest step in progress
+        unsigned long long next = ticks;
+        {
+            GRAVITY_PROFILE_SCOPE(m_profiler, Integration);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                if (m_bodies.Static[i])
+                {
+                    continue;
+                }
+                const unsigned long long stepTicks = 1ull << (levels - level[i]);
+                if (now % stepTicks == 0)
+                {
+                    const double halfStep = 0.5 * tick * static_cast<double>(stepTicks);
+                    m_bodies.VX[i] += halfStep * m_bodies.AX[i];
+                    m_bodies.VY[i] += halfStep * m_bodies.AY[i];
+                }
+                next = std::min(next, now - now % stepTicks + stepTicks);
+            }
+        }
+        Drift(tick * static_cast<double>(next - now));
+        now = next;
+
+        m_active.clear();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (!m_bodies.Static[i] && now % (1ull << (levels - level[i])) == 0)
+            {
+                m_active.push_back(i);
+            }
+        }
+        const std::size_t activeCount = m_active.size();
+        m_previousAX.resize(activeCount);
+        m_previousAY.resize(activeCount);
+        m_activeAX.resize(activeCount);
+        m_activeAY.resize(activeCount);
+        for (std::size_t k = 0; k < activeCount; ++k)
+        {
+            m_previousAX[k] = m_bodies.AX[m_active[k]];
+            m_previousAY[k] = m_bodies.AY[m_active[k]];
+        }
+
+        if (now == ticks)
+        {
+            // Everything is synchronised, which is also where the diagnostics are taken
+            ComputeAccelerations(diagnose);
+            for (std::size_t k = 0; k < activeCount; ++k)
+            {
+                m_activeAX[k] = m_bodies.AX[m_active[k]];
+                m_activeAY[k] = m_bodies.AY[m_active[k]];
+            }
+        }
+        else
+        {
+            ComputeAccelerations(m_active, m_activeAX.data(), m_activeAY.data());
+        }
+
+        // Closing half kick, then pick the next step from the change in acceleration over this one
+        GRAVITY_PROFILE_SCOPE(m_profiler, Integration);
+        for (std::size_t k = 0; k < activeCount; ++k)
+        {
+            const std::size_t i = m_active[k];
+            const double step = tick * static_cast<double>(1ull << (levels - level[i]));
+            const double ax = m_activeAX[k];
+            const double ay = m_activeAY[k];
+            m_bodies.AX[i] = ax;
+            m_bodies.AY[i] = ay;
+            m_bodies.VX[i] += 0.5 * step * ax;
+            m_bodies.VY[i] += 0.5 * step * ay;
+
+            const double jerkX = (ax - m_previousAX[k]) / step;
+            const double jerkY = (ay - m_previousAY[k]) / step;
+            const double a = std::sqrt(ax*ax + ay*ay);
+            const double jerk = std::sqrt(jerkX*jerkX + jerkY*jerkY);
+            const unsigned int wanted = jerk > 0.0 ? TimestepLevel(a / jerk) : 0;
+
+            // Shorter steps can start at any time, longer ones only where their steps start and by one
+            // level at a time, so no body ever overshoots the next synchronisation
+            unsigned int newLevel = level[i];
+            if (wanted > newLevel)
+            {
+                newLevel = wanted;
+            }
+            else if (wanted < newLevel && now % (1ull << (levels - newLevel + 1)) == 0)
+            {
+                newLevel = newLevel - 1;
+            }
+            level[i] = static_cast<unsigned char>(newLevel);
+        }
+    }
 }
 
-void Simulation::dt(double dt)
+void Simulation::UpdateDiagnostics()
 {
-    m_dt = dt;
+    GRAVITY_PROFILE_SCOPE(m_profiler, Diagnostics);
+    // The potential has already been filled in by the force pass at the same positions
+    double kinetic = 0.0;
+    double px = 0.0;
+    double py = 0.0;
+    double angularMomentum = 0.0;
+    for (std::size_t i = 0; i < m_bodies.Size(); ++i)
+    {
+        if (m_bodies.Static[i])
+        {
+            continue;
+        }
+        const double m = m_bodies.Mass[i];
+        const double vx = m_bodies.VX[i];
+        const double vy = m_bodies.VY[i];
+        kinetic += 0.5 * m * (vx*vx + vy*vy);
+        px += m * vx;
+        py += m * vy;
+        angularMomentum += m * (m_bodies.X[i] * vy - m_bodies.Y[i] * vx);
+    }
+
+    m_diagnostics.StepCount = m_stepCount;
+    m_diagnostics.Time = m_time;
+    m_diagnostics.KineticEnergy = kinetic;
+    m_diagnostics.TotalEnergy = kinetic + m_diagnostics.PotentialEnergy;
+    m_diagnostics.MomentumX = px;
+    m_diagnostics.MomentumY = py;
+    m_diagnostics.AngularMomentum = angularMomentum;
 }
 
-double Simulation::dt() const
+void Simulation::ResolveCollisions()
 {
-    return m_dt;
+    GRAVITY_PROFILE_SCOPE(m_profiler, Collisions);
+    const std::size_t count = m_bodies.Size();
+    m_collisionGrid.FindContacts(m_bodies.X.data(), m_bodies.Y.data(), m_bodies.Radius.data(), count, m_contacts);
+    // Frozen bodies (see CullPolicy) are only markers, they neither absorb nor get absorbed
+    auto frozen = [this](std::size_t i)
+    {
+        return m_bodies.Static[i] && m_bodies.Mass[i] == 0.0;
+    };
+    m_contacts.erase(std::remove_if(m_contacts.begin(), m_contacts.end(),
+                                    [&frozen](const std::pair<std::size_t, std::size_t>& contact)
+                                    {
+                                        return frozen(contact.first) || frozen(contact.second);
+                                    }),
+                     m_contacts.end());
+    if (m_contacts.empty())
+    {
+        return;
+    }
+
+    // Bodies touching each other directly or through others are merged as one group, found with a
+    // union-find where each group's root is the body that survives
+    std::vector<std::size_t>& group = m_mergeGroup;
+    group.resize(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        group[i] = i;
+    }
+    auto find = [&group](std::size_t i)
+    {
+        while (group[i] != i)
+        {
+            group[i] = group[group[i]];
+            i = group[i];
+        }
+        return i;
+    };
+    auto survives = [this](std::size_t a, std::size_t b)
+    {
+        // Static bodies absorb everything, otherwise the heavier body (the older one on a tie, so the result
+        // doesn't depend on the order of the store)
+        if (m_bodies.Static[a] != m_bodies.Static[b])
+        {
+            return m_bodies.Static[a] != 0;
+        }
+        if (m_bodies.Mass[a] != m_bodies.Mass[b])
+        {
+            return m_bodies.Mass[a] > m_bodies.Mass[b];
+        }
+        return m_bodies.Id[a] < m_bodies.Id[b];
+    };
+    for (const auto& contact : m_contacts)
+    {
+        const std::size_t a = find(contact.first);
+        const std::size_t b = find(contact.second);
+        if (a != b)
+        {
+            if (survives(a, b))
+            {
+                group[b] = a;
+            }
+            else
+            {
+                group[a] = b;
+            }
+        }
+    }
+
+    // Accumulate each absorbed body into its survivor. The survivor's position and velocity are switched
+    // to mass-weighted sums (and its radius to a sum of squares) the first time it absorbs a body, then
+    // normalised again at the end. Static bodies stay put and at rest, the momentum they absorb is lost. A
+    // massless survivor (only ever in a group of massless bodies) keeps its own state, as there is no mass
+    // to weight by.
+    m_removed.assign(count, 0);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const std::size_t root = find(i);
+        if (root == i)
+        {
+            continue;
+        }
+        if (!m_removed[root])
+        {
+            m_removed[root] = 2;
+            const double m = m_bodies.Mass[root];
+            if (m > 0.0)
+            {
+                m_bodies.X[root] *= m;
+                m_bodies.Y[root] *= m;
+                m_bodies.VX[root] *= m;
+                m_bodies.VY[root] *= m;
+            }
+            m_bodies.Radius[root] *= m_bodies.Radius[root];
+        }
+        const double m = m_bodies.Mass[i];
+        m_bodies.Mass[root] += m;
+        m_bodies.X[root] += m * m_bodies.X[i];
+        m_bodies.Y[root] += m * m_bodies.Y[i];
+        m_bodies.VX[root] += m * m_bodies.VX[i];
+        m_bodies.VY[root] += m * m_bodies.VY[i];
+        m_bodies.Radius[root] += m_bodies.Radius[i] * m_bodies.Radius[i];
+        m_removed[i] = 1;
+        if (m_bodies.Static[root])
+        {
+            m_bStaticFieldValid = false;
+        }
+        if (m_bodies.Static[i])
+        {
+            --m_staticCount;
+        }
+    }
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (m_removed[i] == 2)
+        {
+            m_removed[i] = 0;
+            m_bodies.Radius[i] = std::sqrt(m_bodies.Radius[i]);
+            if (m_bodies.Static[i])
+            {
+                m_bodies.X[i] = m_bodies.InitialPosition[i][0];
+                m_bodies.Y[i] = m_bodies.InitialPosition[i][1];
+                m_bodies.VX[i] = 0.0;
+                m_bodies.VY[i] = 0.0;
+                continue;
+            }
+            const double m = m_bodies.Mass[i];
+            if (m > 0.0)
+            {
+                m_bodies.X[i] /= m;
+                m_bodies.Y[i] /= m;
+                m_bodies.VX[i] /= m;
+                m_bodies.VY[i] /= m;
+            }
+        }
+    }
+
+    m_trails.RemoveMarked(m_removed);
+    m_mergeCount += m_bodies.RemoveMarked(m_removed);
+    m_bAccelerationsValid = false;
+}
+
+void Simulation::CullEscapes()
+{
+    GRAVITY_PROFILE_SCOPE(m_profiler, Culling);
+    const SimulationAxis& xAxis = m_simBounds.x_axis;
+    const SimulationAxis& yAxis = m_simBounds.y_axis;
+    auto outside = [&](std::size_t i)
+    {
+        return !(m_bodies.X[i] >= xAxis.Min && m_bodies.X[i] <= xAxis.Max && m_bodies.Y[i] >= yAxis.Min &&
+                 m_bodies.Y[i] <= yAxis.Max);
+    };
+    std::size_t count = DynamicCount();
+    std::size_t firstOutside = count;
+    for (std::size_t i = 0; i < count && firstOutside == count; ++i)
+    {
+        if (outside(i))
+        {
+            firstOutside = i;
+        }
+    }
+    if (firstOutside == count)
+    {
+        return;
+    }
+
+    // Far outside the bounds the rest of the bodies pull like a point at their centre of mass, with the
+    // potential G*M*ln(r). Climbing from r out to the escape range then takes a radial speed of at least
+    // sqrt(2*G*M*ln(range/r)), any tangential speed only takes the body further.
+    double totalMass = 0.0;
+    double momentX = 0.0;
+    double momentY = 0.0;
+    double momentumX = 0.0;
+    double momentumY = 0.0;
+    for (std::size_t i = 0; i < m_bodies.Size(); ++i)
+    {
+        const double m = m_bodies.Mass[i];
+        totalMass += m;
+        momentX += m * m_bodies.X[i];
+        momentY += m * m_bodies.Y[i];
+        momentumX += m * m_bodies.VX[i];
+        momentumY += m * m_bodies.VY[i];
+    }
+    const double halfWidth = 0.5 * (xAxis.Max - xAxis.Min);
+    const double halfHeight = 0.5 * (yAxis.Max - yAxis.Min);
+    const double range = ESCAPE_RANGE * std::sqrt(halfWidth*halfWidth + halfHeight*halfHeight);
+
+    // Downwards so the bodies swapped into a culled body's slot have already been looked at
+    for (std::size_t i = count; i-- > firstOutside;)
+    {
+        if (!outside(i))
+        {
+            continue;
+        }
+        const double m = m_bodies.Mass[i];
+        const double restMass = totalMass - m;
+        double dx = m_bodies.X[i];
+        double dy = m_bodies.Y[i];
+        double ux = m_bodies.VX[i];
+        double uy = m_bodies.VY[i];
+        if (restMass > 0.0)
+        {
+            dx -= (momentX - m * m_bodies.X[i]) / restMass;
+            dy -= (momentY - m * m_bodies.Y[i]) / restMass;
+            ux -= (momentumX - m * m_bodies.VX[i]) / restMass;
+            uy -= (momentumY - m * m_bodies.VY[i]) / restMass;
+        }
+        const double r = std::sqrt(dx*dx + dy*dy);
+        const double radialSpeed = r > 0.0 ? (dx*ux + dy*uy) / r : 0.0;
+        if (!(radialSpeed > 0.0) ||
+            (r < range && radialSpeed * radialSpeed < 2.0 * m_gravConst * std::max(restMass, 0.0) * std::log(range / r)))
+        {
+            continue;
+        }
+
+        m_cullEvents.push_back({ m_bodies.Id[i], m_stepCount, m_time, m_bodies.X[i], m_bodies.Y[i], m_bodies.VX[i],
+                                 m_bodies.VY[i], m });
+        totalMass -= m;
+        momentX -= m * m_bodies.X[i];
+        momentY -= m * m_bodies.Y[i];
+        momentumX -= m * m_bodies.VX[i];
+        momentumY -= m * m_bodies.VY[i];
+        if (m_cullPolicy == CullPolicy::Remove)
+        {
+            RemoveAt(i);
+        }
+        else
+        {
+            // Frozen in place, and reset to here too
+            m_bodies.VX[i] = 0.0;
+            m_bodies.VY[i] = 0.0;
+            m_bodies.AX[i] = 0.0;
+            m_bodies.AY[i] = 0.0;
+            m_bodies.Mass[i] = 0.0;
+            m_bodies.Static[i] = 1;
+            m_bodies.InitialPosition[i] = Vector2(m_bodies.X[i], m_bodies.Y[i]);
+            m_bodies.InitialVelocity[i] = Vector2();
+            SwapBodies(i, count - 1);
+            ++m_staticCount;
+            m_bAccelerationsValid = false;
+        }
+        --count;
+    }
+}
+
+void Simulation::Kick(double dt)
+{
+    GRAVITY_PROFILE_SCOPE(m_profiler, Integration);
+    for (std::size_t i = 0; i < m_bodies.Size(); ++i)
+    {
+        if (!m_bodies.Static[i])
+        {
+            m_bodies.VX[i] += dt * m_bodies.AX[i];
+            m_bodies.VY[i] += dt * m_bodies.AY[i];
+        }
+    }
+}
+
+void Simulation::Drift(double dt)
+{
+    GRAVITY_PROFILE_SCOPE(m_profiler, Integration);
+    for (std::size_t i = 0; i < m_bodies.Size(); ++i)
+    {
+        if (!m_bodies.Static[i])
+        {
+            m_bodies.X[i] += dt * m_bodies.VX[i];
+            m_bodies.Y[i] += dt * m_bodies.VY[i];
+        }
+    }
+}
+
+template<class INTEGRATOR>
+void Simulation::Integrate(double dt, bool diagnose)
+{
+    // Accelerations are carried over from the end of the previous step, they only need computing here
+    // after the bodies or force parameters have changed
+    if (!m_bAccelerationsValid)
+    {
+        INTEGRATOR::Prepare(*this);
+    }
+    INTEGRATOR::Step(*this, dt, diagnose);
+}
+
+void Simulation::ComputeAccelerationsAndJerks(bool withPotential)
+{
+    GRAVITY_PROFILE_SCOPE(m_profiler, Forces);
+    // The jerks need the velocities as well, which none of the approximate solvers carry, so this is
+    // always a direct sum
+    const double eps = m_soften ? SOFTENING : 0.0;
+    const std::size_t count = DynamicCount();
+    m_jerkX.assign(m_bodies.Size(), 0.0);
+    m_jerkY.assign(m_bodies.Size(), 0.0);
+    double potential = 0.0;
+    std::mutex potentialMutex;
+    m_threadPool.ParallelFor(count, 0, [&](std::size_t begin, std::size_t end)
+    {
+        double chunkPotential = 0.0;
+        DirectSumAccelerationsJerksRange(m_bodies.X.data(), m_bodies.Y.data(), m_bodies.VX.data(), m_bodies.VY.data(),
+                                         m_bodies.Mass.data(), count, begin, end, m_gravConst, eps,
+                                         m_bodies.AX.data(), m_bodies.AY.data(), m_jerkX.data(), m_jerkY.data(),
+                                         withPotential ? &chunkPotential : nullptr);
+        if (withPotential)
+        {
+            std::lock_guard<std::mutex> lock(potentialMutex);
+            potential += chunkPotential;
+        }
+    });
+    m_interactionCount += count > 0 ? count * (count - 1) : 0;
+
+    if (m_staticCount > 0)
+    {
+        // The static bodies' jerks need the exact field, the grid has no derivatives
+        PrepareStaticField();
+        std::fill(m_bodies.AX.begin() + count, m_bodies.AX.end(), 0.0);
+        std::fill(m_bodies.AY.begin() + count, m_bodies.AY.end(), 0.0);
+        m_threadPool.ParallelFor(count, 0, [&](std::size_t begin, std::size_t end)
+        {
+            double chunkPotential = 0.0;
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                m_staticField.AddAccelerationJerk(m_bodies.X[i], m_bodies.Y[i], m_bodies.VX[i], m_bodies.VY[i],
+                                                  m_bodies.AX[i], m_bodies.AY[i], m_jerkX[i], m_jerkY[i]);
+                if (withPotential)
+                {
+                    chunkPotential += m_bodies.Mass[i] * m_staticField.Potential(m_bodies.X[i], m_bodies.Y[i]);
+                }
+            }
+            if (withPotential)
+            {
+                std::lock_guard<std::mutex> lock(potentialMutex);
+                potential += chunkPotential;
+            }
+        });
+        m_interactionCount += count * m_staticField.Count();
+        if (withPotential)
+        {
+            potential += m_staticField.SelfPotential();
+        }
+    }
+
+    if (withPotential)
+    {
+        m_diagnostics.PotentialEnergy = potential;
+    }
+    m_bAccelerationsValid = true;
+}
+
+void Simulation::SaveState()
+{
+    GRAVITY_PROFILE_SCOPE(m_profiler, Integration);
+    m_startX = m_bodies.X;
+    m_startY = m_bodies.Y;
+    m_startVX = m_bodies.VX;
+    m_startVY = m_bodies.VY;
+    m_startAX = m_bodies.AX;
+    m_startAY = m_bodies.AY;
+    m_startJerkX = m_jerkX;
+    m_startJerkY = m_jerkY;
+}
+
+void Simulation::Predict(double dt)
+{
+    GRAVITY_PROFILE_SCOPE(m_profiler, Integration);
+    // r_p = r_0 + v_0*dt + a_0*dt^2/2 + j_0*dt^3/6
+    // v_p = v_0 + a_0*dt + j_0*dt^2/2
+    const double dt2 = dt * dt / 2.0;
+    const double dt3 = dt * dt * dt / 6.0;
+    for (std::size_t i = 0; i < m_bodies.Size(); ++i)
+    {
+        if (!m_bodies.Static[i])
+        {
+            m_bodies.X[i] += m_bodies.VX[i]*dt + m_bodies.AX[i]*dt2 + m_jerkX[i]*dt3;
+            m_bodies.Y[i] += m_bodies.VY[i]*dt + m_bodies.AY[i]*dt2 + m_jerkY[i]*dt3;
+            m_bodies.VX[i] += m_bodies.AX[i]*dt + m_jerkX[i]*dt2;
+            m_bodies.VY[i] += m_bodies.AY[i]*dt + m_jerkY[i]*dt2;
+        }
+    }
+}
+
+void Simulation::Correct(double dt)
+{
+    GRAVITY_PROFILE_SCOPE(m_profiler, Integration);
+    // v_1 = v_0 + (a_0 + a_1)*dt/2 + (j_0 - j_1)*dt^2/12
+    // r_1 = r_0 + (v_0 + v_1)*dt/2 + (a_0 - a_1)*dt^2/12
+    const double dt12 = dt * dt / 12.0;
+    for (std::size_t i = 0; i < m_bodies.Size(); ++i)
+    {
+        if (!m_bodies.Static[i])
+        {
+            m_bodies.VX[i] = m_startVX[i] + 0.5*dt*(m_startAX[i] + m_bodies.AX[i]) + dt12*(m_startJerkX[i] - m_jerkX[i]);
+            m_bodies.VY[i] = m_startVY[i] + 0.5*dt*(m_startAY[i] + m_bodies.AY[i]) + dt12*(m_startJerkY[i] - m_jerkY[i]);
+            m_bodies.X[i] = m_startX[i] + 0.5*dt*(m_startVX[i] + m_bodies.VX[i]) + dt12*(m_startAX[i] - m_bodies.AX[i]);
+            m_bodies.Y[i] = m_startY[i] + 0.5*dt*(m_startVY[i] + m_bodies.VY[i]) + dt12*(m_startAY[i] - m_bodies.AY[i]);
+        }
+    }
+}
+
+void Simulation::Update()
+{
+    // Don't do anything if we are paused
+    if (m_bPaused) return;
+    GRAVITY_PROFILE_SCOPE(m_profiler, Step);
+
+    // On diagnostic steps the potential energy is accumulated by the force pass at the end of the step
+    const bool diagnose = m_diagnosticsInterval > 0 && (m_stepCount + 1) % m_diagnosticsInterval == 0;
+
+    const double dt = m_dt;
+    if (m_bBlockTimesteps)
+    {
+        // Block steps are kick-drift-kick leapfrog on each body's own step
+        if (!m_bAccelerationsValid)
+        {
+            ComputeAccelerations();
+            InitTimestepLevels();
+        }
+        BlockStep(diagnose);
+    }
+    else
+    {
+        (this->*m_integrate)(dt, diagnose);
+    }
+
+    ++m_stepCount;
+    m_time += dt;
+
+    if (diagnose)
+    {
+        UpdateDiagnostics();
+    }
+
+    if (m_bCollisions)
+    {
+        ResolveCollisions();
+    }
+
+    if (m_cullPolicy != CullPolicy::Keep)
+    {
+        CullEscapes();
+    }
+
+    if (m_reorderInterval > 0 && m_stepCount % m_reorderInterval == 0)
+    {
+        ReorderBodies();
+    }
+
+    if (m_trails.Capacity() > 0 && m_stepCount % m_trailInterval == 0)
+    {
+        GRAVITY_PROFILE_SCOPE(m_profiler, Trails);
+        m_trails.Record(m_bodies.X.data(), m_bodies.Y.data(), m_bodies.Size());
+    }
+}
+
+unsigned int Simulation::Step(unsigned int n)
+{
+    if (m_bPaused) return 0;
+
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        Update();
+    }
+    return n;
+}
+
+unsigned int Simulation::Advance(double simTime, double wallClockBudgetMs)
+{
+    if (m_bPaused || m_dt <= 0.0) return 0;
+
+    const auto deadline = std::chrono::steady_clock::now() +
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(wallClockBudgetMs));
+
+    // Time that doesn't make up a whole step is carried over to the next call
+    m_pendingTime += simTime;
+    unsigned int steps = 0;
+    while (m_pendingTime >= m_dt)
+    {
+        if (steps > 0 && std::chrono::steady_clock::now() >= deadline)
+        {
+            // Out of budget, drop the rest rather than letting the backlog build up call after call
+            m_pendingTime = 0.0;
+            break;
+        }
+        Update();
+        m_pendingTime -= m_dt;
+        ++steps;
+    }
+    return steps;
+}
+
+void Simulation::Reset()
+{
+    for (std::size_t i = 0; i < m_bodies.Size(); ++i)
+    {
+        m_bodies.X[i] = m_bodies.InitialPosition[i][0];
+        m_bodies.Y[i] = m_bodies.InitialPosition[i][1];
+        m_bodies.VX[i] = m_bodies.InitialVelocity[i][0];
+        m_bodies.VY[i] = m_bodies.InitialVelocity[i][1];
+    }
+    m_bAccelerationsValid = false;
+    m_stepCount = 0;
+    m_time = 0.0;
+    m_pendingTime = 0.0;
+    m_diagnostics = SimulationDiagnostics();
+    m_trails.Reset(m_bodies.X.data(), m_bodies.Y.data(), m_bodies.Size());
+}
+
+void Simulation::Pause()
+{
+    m_bPaused = !m_bPaused;
+}
+
+bool Simulation::IsPaused()
+{
+    return m_bPaused;
+}
+
+double Simulation::G() const
+{
+    return m_gravConst;
+}
+
+void Simulation::G(double g)
+{
+    m_gravConst = g;
+    m_bAccelerationsValid = false;
+    m_bStaticFieldValid = false;
+}
+
+void Simulation::G(double massScale, double timeScale, double lengthScale)
+{
+    m_gravConst = (GCONST * massScale * timeScale * timeScale) / (lengthScale * lengthScale * lengthScale);
+    m_bAccelerationsValid = false;
+    m_bStaticFieldValid = false;
+}
+
+double Simulation::Energy() const
+{
+    // E = 0.5 * sum{i=1..N}(m_i v_i^2) + sum{i<j}(U(r_i - r_j)), see PairPotential for U
+    const double eps = Softening();
+    double energy = 0.0;
+    for (std::size_t i = 0; i < m_bodies.Size(); ++i)
+    {
+        if (!m_bodies.Static[i])
+        {
+            energy += 0.5*m_bodies.Mass[i]*(m_bodies.VX[i]*m_bodies.VX[i] + m_bodies.VY[i]*m_bodies.VY[i]);
+        }
+        for (std::size_t j = i + 1; j < m_bodies.Size(); ++j)
+        {
+            energy += PairPotential(m_bodies.X[j] - m_bodies.X[i], m_bodies.Y[j] - m_bodies.Y[i],
+                                    m_bodies.Mass[i], m_bodies.Mass[j], m_gravConst, eps);
+        }
+    }
+    return energy;
+}
+
+double Simulation::AngularMomentum() const
+{
+    // L_z = sum{i=1..N}(m_i (x_i vy_i - y_i vx_i)), about the origin
+    double angularMomentum = 0.0;
+    for (std::size_t i = 0; i < m_bodies.Size(); ++i)
+    {
+        if (!m_bodies.Static[i])
+        {
+            angularMomentum += m_bodies.Mass[i]*(m_bodies.X[i]*m_bodies.VY[i] - m_bodies.Y[i]*m_bodies.VX[i]);
+        }
+    }
+    return angularMomentum;
+}
+
+void Simulation::DiagnosticsInterval(unsigned int steps)
+{
+    m_diagnosticsInterval = steps;
+}
+
+unsigned int Simulation::DiagnosticsInterval() const
+{
+    return m_diagnosticsInterval;
+}
+
+const SimulationDiagnostics& Simulation::Diagnostics() const
+{
+    return m_diagnostics;
+}
+
+CheckpointHeader Simulation::MakeCheckpointHeader() const
+{
+    CheckpointHeader header;
+    header.StepCount = m_stepCount;
+    header.MergeCount = m_mergeCount;
+    header.Time = m_time;
+    header.PendingTime = m_pendingTime;
+    header.G = m_gravConst;
+    header.Dt = m_dt;
+    header.BoundsMinX = m_simBounds.x_axis.Min;
+    header.BoundsMaxX = m_simBounds.x_axis.Max;
+    header.BoundsMinY = m_simBounds.y_axis.Min;
+    header.BoundsMaxY = m_simBounds.y_axis.Max;
+    header.NextId = m_nextId;
+    header.MaxTimestepLevel = m_maxTimestepLevel;
+    header.Soften = m_soften;
+    header.AccelerationsValid = m_bAccelerationsValid;
+    return header;
+}
+
+void Simulation::RestoreCheckpointHeader(const CheckpointHeader& header)
+{
+    m_stepCount = header.StepCount;
+    m_mergeCount = header.MergeCount;
+    m_time = header.Time;
+    m_pendingTime = header.PendingTime;
+    m_gravConst = header.G;
+    m_dt = header.Dt;
+    SetSimBounds(header.BoundsMinX, header.BoundsMaxX, header.BoundsMinY, header.BoundsMaxY);
+    m_nextId = header.NextId;
+    m_soften = header.Soften;
+    m_diagnostics = SimulationDiagnostics();
+    // The body columns were read into fresh storage, put back the capacity that was reserved
+    GRAVITY_COUNT_ALLOCATION(m_profiler);
+    m_bodies.Reserve(m_reservedBodies);
+    ReserveScratch();
+    // Checkpoints written before static bodies were kept last may need partitioning
+    m_staticCount = 0;
+    m_bStaticFieldValid = false;
+    PartitionStatic(0);
+    m_trails.Reset(m_bodies.X.data(), m_bodies.Y.data(), m_bodies.Size());
+    // The accelerations carried over to the next step are restored as they were, recomputing them would
+    // differ for integrators that carry them from a predicted state (Hermite). Hermite needs the jerks too.
+    m_bAccelerationsValid = header.AccelerationsValid &&
+            (m_integrator != IntegrationMethod::Hermite || m_jerkX.size() == m_bodies.Size());
+    // Timestep levels deeper than this simulation allows are clamped, and with block timesteps picked afresh
+    // along with the accelerations, as block steps can't schedule them
+    bool deeper = header.MaxTimestepLevel > m_maxTimestepLevel;
+    for (unsigned char& level : m_bodies.TimestepLevel)
+    {
+        if (level > m_maxTimestepLevel)
+        {
+            level = static_cast<unsigned char>(m_maxTimestepLevel);
+            deeper = true;
+        }
+    }
+    if (deeper && m_bBlockTimesteps)
+    {
+        m_bAccelerationsValid = false;
+    }
+}
+
+bool Simulation::Save(const std::string& path, std::string& error) const
+{
+    std::vector<unsigned char> buffer;
+    Save(buffer);
+    return WriteCheckpointFile(path, buffer, error);
+}
+
+bool Simulation::Load(const std::string& path, std::string& error)
+{
+    CheckpointHeader header;
+    if (!ReadCheckpointFile(path, header, m_bodies, m_jerkX, m_jerkY, error))
+    {
+        return false;
+    }
+    RestoreCheckpointHeader(header);
+    return true;
+}
+
+void Simulation::Save(std::vector<unsigned char>& buffer) const
+{
+    WriteCheckpoint(MakeCheckpointHeader(), m_bodies, m_jerkX, m_jerkY, buffer);
+}
+
+bool Simulation::Load(const unsigned char* data, std::size_t size, std::string& error)
+{
+    CheckpointHeader header;
+    if (!ReadCheckpoint(data, size, header, m_bodies, m_jerkX, m_jerkY, error))
+    {
+        return false;
+    }
+    RestoreCheckpointHeader(header);
+    return true;
+}
+
+std::vector<Body> Simulation::Bodies() const
+{
+    std::vector<Body> bodies;
+    bodies.reserve(m_bodies.Size());
+    for (std::size_t i = 0; i < m_bodies.Size(); ++i)
+    {
+        bodies.emplace_back(m_bodies, i);
+    }
+    return bodies;
+}
+
+Body Simulation::GetBody(int index) const
+{
+    return Body(m_bodies, index);
+}
+
+const BodyStore& Simulation::Store() const
+{
+    return m_bodies;
+}
+
+Profiler& Simulation::Profile()
+{
+    return m_profiler;
+}
+
+const Profiler& Simulation::Profile() const
+{
+    return m_profiler;
+}
+
+unsigned int Simulation::StorageGeneration() const
+{
+    return m_bodies.Generation();
+}
+
+int Simulation::BodyIndex(unsigned int id) const
+{
+    const std::size_t index = m_bodies.IndexOf(id);
+    return index == BodyStore::NO_INDEX ? -1 : static_cast<int>(index);
+}
+
+Simulation::CullPolicy Simulation::Culling() const
+{
+    return m_cullPolicy;
+}
+
+void Simulation::Culling(CullPolicy policy)
+{
+    m_cullPolicy = policy;
+}
+
+const std::vector<CullEvent>& Simulation::CullEvents() const
+{
+    return m_cullEvents;
+}
+
+void Simulation::ClearCullEvents()
+{
+    m_cullEvents.clear();
+}
+
+unsigned int Simulation::ReorderInterval() const
+{
+    return m_reorderInterval;
+}
+
+void Simulation::ReorderInterval(unsigned int steps)
+{
+    m_reorderInterval = steps;
+    ReserveScratch();
+}
+
+void Simulation::ReorderBodies()
+{
+    GRAVITY_PROFILE_SCOPE(m_profiler, Reorder);
+    // Only the dynamic bodies, the static ones stay last. Everything kept per body moves with it: the
+    // accelerations carried to the next step and the timestep levels are in the store, the trails and jerks
+    // are alongside it.
+    MortonOrder(m_bodies.X.data(), m_bodies.Y.data(), DynamicCount(), m_reorder, m_reorderKeys);
+    m_bodies.Permute(m_reorder, m_reorderScratch);
+    m_trails.Permute(m_reorder, m_reorderScratch);
+    if (m_jerkX.size() >= m_reorder.size())
+    {
+        PermuteColumn(m_jerkX, m_reorder, m_reorderScratch);
+        PermuteColumn(m_jerkY, m_reorder, m_reorderScratch);
+    }
+}
+
+void Simulation::soften(bool value)
+{
+    m_soften = value;
+    m_bAccelerationsValid = false;
+    m_bStaticFieldValid = false;
+}
+
+double Simulation::Softening() const
+{
+    return m_soften ? SOFTENING : 0.0;
+}
+
+Simulation::ForceSolver Simulation::Solver() const
+{
+    return m_solver;
+}
+
+void Simulation::Solver(ForceSolver solver)
+{
+    m_solver = solver;
+    m_bAccelerationsValid = false;
+    ReserveScratch();
+}
+
+Simulation::ForcePrecision Simulation::Precision() const
+{
+    return m_precision;
+}
+
+void Simulation::Precision(ForcePrecision precision)
+{
+    m_precision = precision;
+    m_bAccelerationsValid = false;
+    ReserveScratch();
+}
+
+double Simulation::Theta() const
+{
+    return m_theta;
+}
+
+void Simulation::Theta(double theta)
+{
+    m_theta = theta;
+    m_bAccelerationsValid = false;
+}
+
+double Simulation::BarnesHutError(double theta)
+{
+    const std::size_t count = m_bodies.Size();
+    if (count < 2)
+    {
+        return 0.0;
+    }
+
+    const ForceSolver solver = m_solver;
+    const double currentTheta = m_theta;
+    const unsigned long long interactions = m_interactionCount;
+
+    std::vector<Vector2> reference(count);
+    m_solver = ForceSolver::DirectSum;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        reference[i] = CalculateTotalForceOnBody(i, m_soften);
+    }
+
+    m_solver = ForceSolver::BarnesHut;
+    m_theta = theta;
+    BuildForceSolver();
+    double sumSquaredError = 0.0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const Vector2 approx = CalculateTotalForceOnBody(i, m_soften);
+        const double referenceNorm = reference[i].Norm();
+        if (referenceNorm > 0.0)
+        {
+            const double error = (approx - reference[i]).Norm() / referenceNorm;
+            sumSquaredError += error * error;
+        }
+    }
+
+    m_solver = solver;
+    m_theta = currentTheta;
+    m_interactionCount = interactions;
+    return std::sqrt(sumSquaredError / count);
+}
+
+unsigned int Simulation::MeshSize() const
+{
+    return m_mesh.GridSize();
+}
+
+void Simulation::MeshSize(unsigned int nodes)
+{
+    m_mesh.GridSize(nodes);
+    m_bAccelerationsValid = false;
+    ReserveScratch();
+}
+
+unsigned int Simulation::Threads() const
+{
+    return m_threadPool.ThreadCount();
+}
+
+void Simulation::Threads(unsigned int count)
+{
+    m_threadPool.Resize(count == 0 ? ThreadPool::HardwareThreads() : count);
+}
+
+unsigned long long Simulation::InteractionCount() const
+{
+    return m_interactionCount;
+}
+
+Simulation::IntegrationMethod Simulation::Integrator() const
+{
+    return m_integrator;
+}
+
+bool Simulation::BlockTimesteps() const
+{
+    return m_bBlockTimesteps;
+}
+
+void Simulation::BlockTimesteps(bool enabled)
+{
+    m_bBlockTimesteps = enabled;
+    m_bAccelerationsValid = false;
+    ReserveScratch();
+}
+
+unsigned int Simulation::MaxTimestepLevel() const
+{
+    return m_maxTimestepLevel;
+}
+
+void Simulation::MaxTimestepLevel(unsigned int levels)
+{
+    // Levels are stored in a byte and time is counted in 2^levels ticks per step
+    m_maxTimestepLevel = std::min(levels, 30u);
+    m_bAccelerationsValid = false;
+}
+
+double Simulation::TimestepAccuracy() const
+{
+    return m_timestepAccuracy;
+}
+
+void Simulation::TimestepAccuracy(double eta)
+{
+    m_timestepAccuracy = eta;
+}
+
+bool Simulation::Collisions() const
+{
+    return m_bCollisions;
+}
+
+void Simulation::Collisions(bool enabled)
+{
+    m_bCollisions = enabled;
+    ReserveScratch();
+}
+
+unsigned long long Simulation::MergeCount() const
+{
+    return m_mergeCount;
+}
+
+std::size_t Simulation::TrailLength() const
+{
+    return m_trails.Capacity();
+}
+
+void Simulation::TrailLength(std::size_t samples)
+{
+    m_trails.Capacity(samples);
+    ReserveScratch();
+    m_trails.Reset(m_bodies.X.data(), m_bodies.Y.data(), m_bodies.Size());
+}
+
+unsigned int Simulation::TrailInterval() const
+{
+    return m_trailInterval;
+}
+
+void Simulation::TrailInterval(unsigned int steps)
+{
+    m_trailInterval = std::max(steps, 1u);
+}
+
+const TrailBuffer& Simulation::Trails() const
+{
+    return m_trails;
+}
+
+void Simulation::dt(double dt)
+{
+    m_dt = dt;
+}
+
+double Simulation::dt() const
+{
+    return m_dt;
+}
+
+double Simulation::Time() const
+{
+    return m_time;
+}
+
+unsigned long long Simulation::StepCount() const
+{
+    return m_stepCount;
 }
 
 Vector2 Simulation::centerOfMass() const
@@ -243,10 +1882,10 @@ Vector2 Simulation::centerOfMass() const
     // Get sum of position of all bodies * its mass / total mass
     Vector2 CoM;
     double totalMass = 0;
-    for (auto& body : m_bodies)
+    for (std::size_t i = 0; i < m_bodies.Size(); ++i)
     {
-        totalMass += body.Mass();
-        CoM += body.Position() * body.Mass();
+        totalMass += m_bodies.Mass[i];
+        CoM += Vector2(m_bodies.X[i], m_bodies.Y[i]) * m_bodies.Mass[i];
     }
     return CoM * (1.0 / totalMass);
 }
@@ -1,9 +1,24 @@
+#pragma once
+
+#include <atomic>
+#include <string>
 #include <vector>
 #include <iostream>
+#include <mutex>
 #include <chrono>
 #include <thread>
 
 #include "body.hpp"
+#include "body_store.hpp"
+#include "checkpoint.hpp"
+#include "collision_grid.hpp"
+#include "integrators.hpp"
+#include "particle_mesh.hpp"
+#include "profiler.hpp"
+#include "quadtree.hpp"
+#include "static_field.hpp"
+#include "thread_pool.hpp"
+#include "trail_buffer.hpp"
 
 static double GCONST = 6.67408e-11;
 
@@ -19,26 +34,109 @@ struct SimulationBounds2D
     SimulationAxis y_axis;
 };
 
+// Conserved quantities of the dynamic (non-static) bodies, all evaluated at the same synchronised time
+struct SimulationDiagnostics
+{
+    unsigned long long StepCount;
+    double Time;
+    double KineticEnergy;
+    double PotentialEnergy;
+    double TotalEnergy;
+    double MomentumX;
+    double MomentumY;
+    double AngularMomentum;     // z component, about the origin
+};
+
+// A body culled for leaving the simulation bounds on an escape trajectory, as it was when it was culled
+struct CullEvent
+{
+    unsigned int Id;
+    unsigned long long StepCount;
+    double Time;
+    double X;
+    double Y;
+    double VX;
+    double VY;
+    double Mass;
+};
+
+// Bytes allocated by a simulation, counting reserved capacity as well as what is in use
+struct SimulationMemory
+{
+    std::size_t Bodies;         // Body columns
+    std::size_t Scratch;        // Force solver, integrator and collision working buffers
+    std::size_t Trails;
+    std::size_t Total;
+};
+
 class Simulation
 {
 public:
-    Simulation();
-    ~Simulation();
-
     enum IntegrationMethod
     {
         Euler,
         Taylor,
-        Leapfrog
+        Leapfrog,
+        Yoshida,
+        Omelyan,
+        Hermite
     };
 
-    void AddBody(double mass, double radius, bool isStatic = false);
-    void AddBody(double mass, double radius, Vector2 position, bool isStatic = false);
-    void AddBody(double mass, double radius, Vector2 position, Vector2 velocity, bool isStatic = false);
-    void AddBody(double mass, double radius, Vector2 position, Vector2 velocity, Vector3 colour, bool isStatic = false);
-    void AddBodies(std::vector<Body> bodies);
+    // The integrator is fixed for the lifetime of the simulation, see integrators.hpp
+    explicit Simulation(IntegrationMethod integrator = IntegrationMethod::Leapfrog);
+    ~Simulation();
+
+    enum ForceSolver
+    {
+        DirectSum,
+        BarnesHut,
+        ParticleMesh
+    };
+
+    // Precision of the direct sum force pass. Mixed keeps positions, velocities and the integration in
+    // double but evaluates the pair forces in single precision (relative to the mean position, with G
+    // folded into the masses), which halves the memory traffic and doubles the SIMD lanes. Relative force
+    // errors are around 1e-6, fine for visualisation, not for long conservative runs.
+    enum ForcePrecision
+    {
+        Double,
+        Mixed
+    };
+
+    // Each returns the id of the new body
+    unsigned int AddBody(double mass, double radius, bool isStatic = false);
+    unsigned int AddBody(double mass, double radius, Vector2 position, bool isStatic = false);
+    unsigned int AddBody(double mass, double radius, Vector2 position, Vector2 velocity, bool isStatic = false);
+    unsigned int AddBody(double mass, double radius, Vector2 position, Vector2 velocity, Vector3 colour, bool isStatic = false);
+    void AddBodies(const std::vector<Body>& bodies);
+    // Adds count bodies from packed columns with a single reservation, velocities may be null (at rest).
+    // Their ids are consecutive from the one returned.
+    unsigned int AddBodies(std::size_t count, const double* mass, const double* radius, const double* x, const double* y,
+                           const double* vx, const double* vy, bool isStatic = false);
+    // Removes the body with the given id in constant time by moving the last dynamic (or static) body into its
+    // place, so other bodies can change index. Returns false if there is no such body.
+    bool RemoveBody(unsigned int id);
     int BodyCount() const;
+    // Static bodies are kept after the dynamic ones, so bodies [0, BodyCount() - StaticCount()) are the
+    // dynamic ones and adding a dynamic body can move a static one. The static bodies' combined field is
+    // cached (see StaticField) and only rebuilt when they, G, the softening or the bounds change.
+    std::size_t StaticCount() const;
+    // Grid nodes along each side of the cached static field, used once there are more than
+    // StaticField::GRID_THRESHOLD static bodies. 0 always sums them exactly.
+    unsigned int StaticFieldGrid() const;
+    void StaticFieldGrid(unsigned int nodes);
+    // Allocates the body columns and the working buffers of the current solver, integrator and options for
+    // up to maxBodies bodies in one go, so adding bodies and stepping don't reallocate until there are more.
+    // Switching solver or options later sizes the new buffers for the same count. Never shrinks.
+    void Reserve(std::size_t maxBodies);
+    std::size_t ReservedBodies() const;
+    SimulationMemory MemoryUsage() const;
     void Update();
+    // Runs n steps, returns the number of steps run (0 if paused)
+    unsigned int Step(unsigned int n);
+    // Runs as many steps as are needed to cover simTime of simulated time, stopping early once
+    // wallClockBudgetMs has elapsed. Returns the number of steps run.
+    unsigned int Advance(double simTime, double wallClockBudgetMs);
     void Reset();
     void Pause();
     bool IsPaused();
@@ -48,32 +146,257 @@ public:
     void G(double massScale, double timeScale, double lengthScale);
 
     void soften(bool value);
+    // Softening currently applied to the squared separation, 0 when softening is disabled
+    double Softening() const;
+
+    ForceSolver Solver() const;
+    void Solver(ForceSolver solver);
+
+    ForcePrecision Precision() const;
+    void Precision(ForcePrecision precision);
+
+    // Barnes-Hut opening angle, smaller is more accurate (0 is equivalent to direct summation)
+    double Theta() const;
+    void Theta(double theta);
+
+    // Acceleration of one body from all the others, by direct summation or, with the Barnes-Hut solver, from
+    // the tree built by the last force pass
+    Vector2 CalculateTotalForceOnBody(std::size_t index, bool soften = false);
+
+    // RMS of the relative error of the Barnes-Hut accelerations against direct summation for the current
+    // state of the simulation, used to pick theta for a scenario
+    double BarnesHutError(double theta);
+
+    // Grid nodes along each side of the particle-mesh solver's mesh (rounded up to a power of two), the
+    // mesh covers the simulation bounds and is doubled in size while bodies lie outside it
+    unsigned int MeshSize() const;
+    void MeshSize(unsigned int nodes);
+
+    const SimulationBounds2D& SimBounds() const;
+    void SetSimBounds(double xMin, double xMax, double yMin, double yMax);
+
+    // Number of threads used for the force evaluation (including the calling thread), 0 uses one per core
+    unsigned int Threads() const;
+    void Threads(unsigned int count);
+
+    // Number of body-body (or body-node) interactions evaluated since the simulation was created
+    unsigned long long InteractionCount() const;
+
+    IntegrationMethod Integrator() const;
+
+    // Hierarchical block timesteps. Each body steps with dt()/2^k, its level k picked from the criterion
+    // dt_i = eta*|a|/|da/dt| whenever its step ends, and only the bodies at the end of their step have their
+    // forces recomputed on each sub-step. dt() becomes the longest step. Always uses leapfrog, whatever the
+    // integrator.
+    bool BlockTimesteps() const;
+    void BlockTimesteps(bool enabled);
+    // Deepest level, the shortest step is dt()/2^levels
+    unsigned int MaxTimestepLevel() const;
+    void MaxTimestepLevel(unsigned int levels);
+    // eta in the timestep criterion, smaller is more accurate
+    double TimestepAccuracy() const;
+    void TimestepAccuracy(double eta);
+
+    // Bodies whose discs overlap at the end of a step are merged into the most massive of them (or a static
+    // one) conserving mass and momentum, the merged body has the combined area. Off by default.
+    bool Collisions() const;
+    void Collisions(bool enabled);
+    // Number of bodies absorbed by merges since the simulation was created
+    unsigned long long MergeCount() const;
+
+    // What becomes of dynamic bodies that leave SimBounds() on an escape trajectory, one moving away from the
+    // centre of mass of the rest fast enough to get ESCAPE_RANGE times further out than the corners of the
+    // bounds before turning back (with the 2D force law nothing escapes for good). Remove deletes them, Freeze
+    // turns them into massless static bodies where they are, which are still drawn but cost no force work.
+    // Checked at the end of every step, each one is recorded in CullEvents(). Keep (the default) does neither.
+    enum CullPolicy
+    {
+        Keep,
+        Remove,
+        Freeze
+    };
+    static constexpr double ESCAPE_RANGE = 10.0;
+    CullPolicy Culling() const;
+    void Culling(CullPolicy policy);
+    // Bodies culled since the events were last cleared, oldest first
+    const std::vector<CullEvent>& CullEvents() const;
+    void ClearCullEvents();
+
+    // Recent positions of every body kept for drawing trails, sampled at the end of every TrailInterval()
+    // steps into rings of TrailLength() samples (see TrailBuffer). A length of 0 (the default) turns them
+    // off, changing the length restarts the trails from the current positions.
+    std::size_t TrailLength() const;
+    void TrailLength(std::size_t samples);
+    unsigned int TrailInterval() const;
+    void TrailInterval(unsigned int steps);
+    const TrailBuffer& Trails() const;
 
     double dt() const;
     void dt(double dt);
 
+    // Simulated time and number of steps since the simulation started (or was last reset)
+    double Time() const;
+    unsigned long long StepCount() const;
+
     Vector2 centerOfMass() const;
 
+    // Computed on demand, Energy() is O(N^2)
     double Energy() const;
-    Vector2 AngularMomentum() const;
+    double AngularMomentum() const;
 
-    const std::vector<Body>& Bodies() const;
+    // Every k steps the potential energy is accumulated by the force pass (and the kinetic energy and
+    // momenta by a pass over the velocities) into Diagnostics(), 0 turns this off
+    void DiagnosticsInterval(unsigned int steps);
+    unsigned int DiagnosticsInterval() const;
+    const SimulationDiagnostics& Diagnostics() const;
+
+    // Checkpoints hold the bodies and the G/dt/softening/time state (see checkpoint.hpp), not the solver,
+    // integrator or thread settings. Loading replaces every body. Both return false and set error on failure.
+    bool Save(const std::string& path, std::string& error) const;
+    bool Load(const std::string& path, std::string& error);
+    void Save(std::vector<unsigned char>& buffer) const;
+    bool Load(const unsigned char* data, std::size_t size, std::string& error);
+
+    // Views of the bodies, these are invalidated when bodies are added or removed
+    std::vector<Body> Bodies() const;
+    Body GetBody(int index) const;
+    const BodyStore& Store() const;
+
+    // Per phase timings and counters, see profiler.hpp. Steps and interactions are StepCount() and
+    // InteractionCount().
+    Profiler& Profile();
+    const Profiler& Profile() const;
+
+    // Changes whenever views over the body store are invalidated, see BodyStore::Generation
+    unsigned int StorageGeneration() const;
+
+    // Current index of the body with the given id (see Body::Id), -1 once it has been merged into another
+    int BodyIndex(unsigned int id) const;
+
+    // Every k steps the dynamic bodies are sorted along a Morton (Z-order) curve, so bodies near each other
+    // in space are near each other in the store and the tree walks, mesh deposits and collision tests stay
+    // in cache. This moves bodies to new indices (ids stay the same) and changes StorageGeneration(). 0 (the
+    // default) never reorders.
+    unsigned int ReorderInterval() const;
+    void ReorderInterval(unsigned int steps);
+    // Sorts the dynamic bodies now
+    void ReorderBodies();
 
 private:
+    friend struct EulerIntegrator;
+    friend struct TaylorIntegrator;
+    friend struct LeapfrogIntegrator;
+    friend struct YoshidaIntegrator;
+    friend struct OmelyanIntegrator;
+    friend struct HermiteIntegrator;
+
     double m_gravConst;
     bool m_bPaused;
     bool m_bDrawVelVectors;
     bool m_soften;
     double m_dt;
+    IntegrationMethod m_integrator;
+    void (Simulation::*m_integrate)(double dt, bool diagnose);
+    ForceSolver m_solver;
+    ForcePrecision m_precision;
+    double m_theta;
+    unsigned long long m_interactionCount;
+    bool m_bAccelerationsValid;
+    unsigned long long m_stepCount;
+    double m_time;
+    double m_pendingTime;
+    unsigned int m_diagnosticsInterval;
+    SimulationDiagnostics m_diagnostics;
+    bool m_bBlockTimesteps;
+    unsigned int m_maxTimestepLevel;
+    double m_timestepAccuracy;
+    bool m_bCollisions;
+    unsigned long long m_mergeCount;
+    unsigned int m_trailInterval;
+    unsigned int m_reorderInterval;
+    CullPolicy m_cullPolicy;
+    std::vector<CullEvent> m_cullEvents;
+    std::size_t m_reservedBodies;
 
-    std::vector<Body> m_bodies;
+    BodyStore m_bodies;
     unsigned int m_nextId;
+    std::size_t m_staticCount;
+    StaticField m_staticField;
+    bool m_bStaticFieldValid;
 
     SimulationBounds2D m_simBounds;
+    QuadTree m_tree;
+    ParticleMeshSolver m_mesh;
+    CollisionGrid m_collisionGrid;
+    std::vector<std::pair<std::size_t, std::size_t>> m_contacts;
+    std::vector<std::size_t> m_mergeGroup;
+    std::vector<unsigned char> m_removed;
+    TrailBuffer m_trails;
+    // Reordering scratch, see MortonOrder
+    std::vector<std::size_t> m_reorder;
+    std::vector<unsigned long long> m_reorderKeys;
+    std::vector<unsigned char> m_reorderScratch;
+    ThreadPool m_threadPool;
+    Profiler m_profiler;
+
+    // Block timestep scratch: bodies at the end of their step and their accelerations before and after
+    std::vector<std::size_t> m_active;
+    std::vector<double> m_activeAX;
+    std::vector<double> m_activeAY;
+    std::vector<double> m_previousAX;
+    std::vector<double> m_previousAY;
+    std::vector<double> m_meshAX;
+    std::vector<double> m_meshAY;
+
+    // Single precision copies of the direct sum inputs and outputs for the mixed precision mode
+    std::vector<float> m_floatX;
+    std::vector<float> m_floatY;
+    std::vector<float> m_floatMass;
+    std::vector<float> m_floatAX;
+    std::vector<float> m_floatAY;
+
+    // Hermite state: jerks and the state at the start of the step
+    std::vector<double> m_jerkX;
+    std::vector<double> m_jerkY;
+    std::vector<double> m_startX;
+    std::vector<double> m_startY;
+    std::vector<double> m_startVX;
+    std::vector<double> m_startVY;
+    std::vector<double> m_startAX;
+    std::vector<double> m_startAY;
+    std::vector<double> m_startJerkX;
+    std::vector<double> m_startJerkY;
 
     void InitSimBounds();
-    void SetSimBounds(double xMin, double xMax, double yMin, double yMax);
+    void ReserveScratch();
+    std::size_t DynamicCount() const;
+    void SwapBodies(std::size_t i, std::size_t j);
+    void RemoveAt(std::size_t index);
+    void CullEscapes();
+    void PartitionStatic(std::size_t first);
+    void PrepareStaticField();
+    double AddStaticField(bool withPotential);
+    void AddStaticField(const std::vector<std::size_t>& targets, double* ax, double* ay);
+    void MeshRegion(double& minX, double& minY, double& size) const;
+    CheckpointHeader MakeCheckpointHeader() const;
+    void RestoreCheckpointHeader(const CheckpointHeader& header);
+
+    void BuildForceSolver();
+    void ComputeAccelerations(bool withPotential = false);
+    void ComputeAccelerations(const std::vector<std::size_t>& targets, double* ax, double* ay);
+    double MixedPrecisionDirectSum(bool withPotential);
+    void BlockStep(bool diagnose);
+    void InitTimestepLevels();
+    unsigned int TimestepLevel(double timescale) const;
+    void UpdateDiagnostics();
+    void ResolveCollisions();
+    void Kick(double dt);
+    void Drift(double dt);
+    template<class INTEGRATOR>
+    void Integrate(double dt, bool diagnose);
 
-    Vector2 CalculateTotalForceOnBody(const Body& body, bool soften = false);
-    void AddBody(Body& body);
+    void ComputeAccelerationsAndJerks(bool withPotential);
+    void SaveState();
+    void Predict(double dt);
+    void Correct(double dt);
 };
\ No newline at end of file
@@ -0,0 +1,225 @@
+#include "static_field.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "force_law.hpp"
+#include "quadtree.hpp"
+
+namespace
+{
+    const double NODE_THETA = 0.3;
+}
+
+StaticField::StaticField() :
+        m_gridSize(256),
+        m_G(0.0),
+        m_eps(0.0),
+        m_selfPotential(0.0),
+        m_bSelfPotentialValid(false),
+        m_minX(0.0),
+        m_minY(0.0),
+        m_spacingX(0.0),
+        m_spacingY(0.0)
+{
+}
+
+unsigned int StaticField::GridSize() const
+{
+    return m_gridSize;
+}
+
+void StaticField::GridSize(unsigned int nodes)
+{
+    // Interpolation needs at least one cell inside the half cell of padding on each side
+    m_gridSize = nodes == 0 ? 0 : std::max(nodes, 3u);
+}
+
+void StaticField::Build(const double* x, const double* y, const double* mass, std::size_t count, double G,
+                        double eps, double minX, double minY, double maxX, double maxY, ThreadPool& pool)
+{
+    m_G = G;
+    m_eps = eps;
+    // Massless bodies (frozen ones, see Simulation::CullPolicy) add nothing and are left out
+    m_x.clear();
+    m_y.clear();
+    m_mass.clear();
+    m_x.reserve(count);
+    m_y.reserve(count);
+    m_mass.reserve(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (mass[i] != 0.0)
+        {
+            m_x.push_back(x[i]);
+            m_y.push_back(y[i]);
+            m_mass.push_back(mass[i]);
+        }
+    }
+    count = m_mass.size();
+
+    m_bSelfPotentialValid = false;
+
+    m_gridAX.clear();
+    m_gridAY.clear();
+    if (count <= GRID_THRESHOLD || m_gridSize == 0 || !(maxX > minX) || !(maxY > minY))
+    {
+        return;
+    }
+
+    // The nodes overhang the region by half a cell on each side, so the outermost static bodies (which set the
+    // region) sit between nodes rather than on them
+    const std::size_t nodes = m_gridSize;
+    m_spacingX = (maxX - minX) / static_cast<double>(nodes - 2);
+    m_spacingY = (maxY - minY) / static_cast<double>(nodes - 2);
+    m_minX = minX - 0.5 * m_spacingX;
+    m_minY = minY - 0.5 * m_spacingY;
+    m_gridAX.resize(nodes * nodes);
+    m_gridAY.resize(nodes * nodes);
+
+    // The nodes are sampled from a Barnes-Hut tree with a tight opening angle, summing every static body at
+    // every node would take seconds for large counts. Its errors are far below those of the interpolation.
+    QuadTree tree;
+    tree.Build(m_x.data(), m_y.data(), m_mass.data(), count);
+    pool.ParallelFor(nodes, 1, [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t j = begin; j < end; ++j)
+        {
+            const double nodeY = m_minY + m_spacingY * static_cast<double>(j);
+            for (std::size_t i = 0; i < nodes; ++i)
+            {
+                const double nodeX = m_minX + m_spacingX * static_cast<double>(i);
+                double ax = 0.0;
+                double ay = 0.0;
+                tree.Acceleration(nodeX, nodeY, count, NODE_THETA, G, eps, ax, ay);
+                if (!std::isfinite(ax) || !std::isfinite(ay))
+                {
+                    // A node still landed on a static body with softening off, sum exactly leaving out any
+                    // body it coincides with rather than spreading its 0/0 through the interpolation
+                    ax = 0.0;
+                    ay = 0.0;
+                    for (std::size_t s = 0; s < count; ++s)
+                    {
+                        const double dx = m_x[s] - nodeX;
+                        const double dy = m_y[s] - nodeY;
+                        if (dx*dx + dy*dy + eps > 0.0)
+                        {
+                            AccumulatePairAcceleration(dx, dy, m_mass[s], G, eps, ax, ay);
+                        }
+                    }
+                }
+                m_gridAX[j * nodes + i] = ax;
+                m_gridAY[j * nodes + i] = ay;
+            }
+        }
+    });
+}
+
+std::size_t StaticField::Count() const
+{
+    return m_mass.size();
+}
+
+bool StaticField::Gridded() const
+{
+    return !m_gridAX.empty();
+}
+
+void StaticField::AddExactAcceleration(double x, double y, double& ax, double& ay) const
+{
+    const std::size_t count = m_mass.size();
+    for (std::size_t s = 0; s < count; ++s)
+    {
+        AccumulatePairAcceleration(m_x[s] - x, m_y[s] - y, m_mass[s], m_G, m_eps, ax, ay);
+    }
+}
+
+void StaticField::AddAcceleration(double x, double y, double& ax, double& ay) const
+{
+    if (m_gridAX.empty())
+    {
+        AddExactAcceleration(x, y, ax, ay);
+        return;
+    }
+
+    const std::size_t nodes = m_gridSize;
+    const double fx = (x - m_minX) / m_spacingX;
+    const double fy = (y - m_minY) / m_spacingY;
+    const double lastCell = static_cast<double>(nodes - 1);
+    if (!(fx >= 0.0 && fx <= lastCell && fy >= 0.0 && fy <= lastCell))
+    {
+        AddExactAcceleration(x, y, ax, ay);
+        return;
+    }
+
+    // Bilinear weights within the cell, the last row/column of nodes uses the cell below/left of it
+    const std::size_t i = std::min(static_cast<std::size_t>(fx), nodes - 2);
+    const std::size_t j = std::min(static_cast<std::size_t>(fy), nodes - 2);
+    const double wx = fx - static_cast<double>(i);
+    const double wy = fy - static_cast<double>(j);
+    const std::size_t n00 = j * nodes + i;
+    const std::size_t n10 = n00 + 1;
+    const std::size_t n01 = n00 + nodes;
+    const std::size_t n11 = n01 + 1;
+    ax += (1.0 - wy) * ((1.0 - wx) * m_gridAX[n00] + wx * m_gridAX[n10]) +
+          wy * ((1.0 - wx) * m_gridAX[n01] + wx * m_gridAX[n11]);
+    ay += (1.0 - wy) * ((1.0 - wx) * m_gridAY[n00] + wx * m_gridAY[n10]) +
+          wy * ((1.0 - wx) * m_gridAY[n01] + wx * m_gridAY[n11]);
+}
+
+void StaticField::AddAccelerationJerk(double x, double y, double vx, double vy, double& ax, double& ay, double& jx,
+                                      double& jy) const
+{
+    // As DirectSumAccelerationsJerksRange with the source at rest, so the relative velocity is -v
+    const std::size_t count = m_mass.size();
+    for (std::size_t s = 0; s < count; ++s)
+    {
+        const double dx = m_x[s] - x;
+        const double dy = m_y[s] - y;
+        const double ux = -vx;
+        const double uy = -vy;
+        const double d2 = dx*dx + dy*dy + m_eps;
+        const double scale = m_G * m_mass[s] / d2;
+        const double rate = 2.0 * (dx*ux + dy*uy) / d2;
+        ax += scale * dx;
+        ay += scale * dy;
+        jx += scale * (ux - rate * dx);
+        jy += scale * (uy - rate * dy);
+    }
+}
+
+double StaticField::Potential(double x, double y) const
+{
+    double potential = 0.0;
+    const std::size_t count = m_mass.size();
+    for (std::size_t s = 0; s < count; ++s)
+    {
+        potential += PairPotential(m_x[s] - x, m_y[s] - y, 1.0, m_mass[s], m_G, m_eps);
+    }
+    return potential;
+}
+
+double StaticField::SelfPotential() const
+{
+    // O(N^2) in the static bodies, so only worked out if it is asked for
+    if (!m_bSelfPotentialValid)
+    {
+        m_selfPotential = 0.0;
+        const std::size_t count = m_mass.size();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            for (std::size_t j = i + 1; j < count; ++j)
+            {
+                m_selfPotential += PairPotential(m_x[j] - m_x[i], m_y[j] - m_y[i], m_mass[i], m_mass[j], m_G, m_eps);
+            }
+        }
+        m_bSelfPotentialValid = true;
+    }
+    return m_selfPotential;
+}
+
+std::size_t StaticField::MemoryBytes() const
+{
+    return (m_x.capacity() + m_y.capacity() + m_mass.capacity() + m_gridAX.capacity() + m_gridAY.capacity()) *
+           sizeof(double);
+}
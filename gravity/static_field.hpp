@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+// Combined field of the static bodies, which never move, so it is built once and reused by every force pass
+// until the static bodies or the force parameters change. A few static bodies are summed exactly from a
+// packed copy of their positions and masses. Past GRID_THRESHOLD of them the accelerations are sampled onto a
+// grid over a region (the simulation bounds) and bilinearly interpolated, which costs the same however many
+// static bodies there are but smooths the field on the scale of a cell. Points outside the grid fall back to
+// the exact sum, as do the jerks and potentials, which are only needed on Hermite and diagnostic steps.
+class StaticField
+{
+public:
+    StaticField();
+
+    // Static bodies above which the grid is used
+    static const std::size_t GRID_THRESHOLD = 1024;
+
+    // Grid nodes along each side, 0 always sums exactly
+    unsigned int GridSize() const;
+    void GridSize(unsigned int nodes);
+
+    void Build(const double* x, const double* y, const double* mass, std::size_t count, double G, double eps,
+               double minX, double minY, double maxX, double maxY, ThreadPool& pool);
+
+    // Static bodies with mass
+    std::size_t Count() const;
+    bool Gridded() const;
+
+    // Adds the acceleration at (x, y)
+    void AddAcceleration(double x, double y, double& ax, double& ay) const;
+    // Adds the acceleration at (x, y) and its rate of change for a body moving with velocity (vx, vy), exact
+    void AddAccelerationJerk(double x, double y, double vx, double vy, double& ax, double& ay, double& jx,
+                             double& jy) const;
+    // Potential energy per unit mass of a body at (x, y) due to the static bodies (see PairPotential), exact
+    double Potential(double x, double y) const;
+    // Potential energy of the static bodies among themselves
+    double SelfPotential() const;
+
+    std::size_t MemoryBytes() const;
+
+private:
+    void AddExactAcceleration(double x, double y, double& ax, double& ay) const;
+
+    unsigned int m_gridSize;
+    double m_G;
+    double m_eps;
+    mutable double m_selfPotential;
+    mutable bool m_bSelfPotentialValid;
+    std::vector<double> m_x;
+    std::vector<double> m_y;
+    std::vector<double> m_mass;
+
+    // Sampled accelerations, row major from (m_minX, m_minY), empty when summing exactly
+    double m_minX;
+    double m_minY;
+    double m_spacingX;
+    double m_spacingY;
+    std::vector<double> m_gridAX;
+    std::vector<double> m_gridAY;
+};
@@ -0,0 +1,138 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool() :
+        m_pTask(nullptr),
+        m_count(0),
+        m_grain(1),
+        m_next(0),
+        m_busy(0),
+        m_generation(0),
+        m_stop(false)
+{
+}
+
+ThreadPool::~ThreadPool()
+{
+    Stop();
+}
+
+unsigned int ThreadPool::ThreadCount() const
+{
+    return static_cast<unsigned int>(m_workers.size()) + 1;
+}
+
+unsigned int ThreadPool::HardwareThreads()
+{
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    // Built without pthreads support, there is only ever the main thread
+    return 1;
+#else
+    return std::max(1u, std::thread::hardware_concurrency());
+#endif
+}
+
+void ThreadPool::Resize(unsigned int threadCount)
+{
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    threadCount = 1;
+#endif
+    threadCount = std::max(1u, threadCount);
+    if (threadCount == ThreadCount())
+    {
+        return;
+    }
+
+    Stop();
+    m_stop = false;
+    for (unsigned int i = 1; i < threadCount; ++i)
+    {
+        m_workers.emplace_back(&ThreadPool::WorkerLoop, this, m_generation);
+    }
+}
+
+void ThreadPool::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+    m_workers.clear();
+}
+
+void ThreadPool::ParallelFor(std::size_t count, std::size_t grain, const Task& task)
+{
+    if (grain == 0)
+    {
+        // A few chunks per thread so the load evens out when chunks take different amounts of time
+        grain = std::max<std::size_t>(16, count / (8 * ThreadCount()));
+    }
+
+    if (m_workers.empty() || count <= grain)
+    {
+        task(0, count);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pTask = &task;
+        m_count = count;
+        m_grain = grain;
+        m_next = 0;
+        m_busy = static_cast<unsigned int>(m_workers.size());
+        ++m_generation;
+    }
+    m_wake.notify_all();
+
+    RunChunks();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_busy == 0; });
+    m_pTask = nullptr;
+}
+
+void ThreadPool::RunChunks()
+{
+    for (;;)
+    {
+        const std::size_t begin = m_next.fetch_add(m_grain);
+        if (begin >= m_count)
+        {
+            break;
+        }
+        (*m_pTask)(begin, std::min(begin + m_grain, m_count));
+    }
+}
+
+void ThreadPool::WorkerLoop(unsigned long long generation)
+{
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stop || m_generation != generation; });
+            if (m_stop)
+            {
+                return;
+            }
+            generation = m_generation;
+        }
+
+        RunChunks();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_busy == 0)
+            {
+                m_done.notify_one();
+            }
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent pool of worker threads used to split the per-body work of a step across cores. The calling
+// thread always takes part in the work, so a pool of size 1 has no workers and runs everything inline.
+class ThreadPool
+{
+public:
+    typedef std::function<void(std::size_t, std::size_t)> Task;
+
+    ThreadPool();
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Total number of threads doing work, including the calling thread
+    unsigned int ThreadCount() const;
+    void Resize(unsigned int threadCount);
+
+    // Number of threads the hardware can run concurrently (1 if unknown or threads are unavailable)
+    static unsigned int HardwareThreads();
+
+    // Calls task(begin, end) for contiguous chunks covering [0, count) and blocks until all have completed.
+    // Chunks of grain items are handed out on demand so threads that finish early pick up remaining work,
+    // a grain of 0 picks one based on the number of threads.
+    void ParallelFor(std::size_t count, std::size_t grain, const Task& task);
+
+private:
+    void WorkerLoop(unsigned long long generation);
+    void RunChunks();
+    void Stop();
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+
+    const Task* m_pTask;
+    std::size_t m_count;
+    std::size_t m_grain;
+    std::atomic<std::size_t> m_next;
+    unsigned int m_busy;
+    unsigned long long m_generation;
+    bool m_stop;
+};
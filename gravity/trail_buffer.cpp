@@ -0,0 +1,162 @@
+#include "trail_buffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+TrailBuffer::TrailBuffer() :
+        m_capacity(0),
+        m_head(0),
+        m_size(0)
+{
+}
+
+std::size_t TrailBuffer::Capacity() const
+{
+    return m_capacity;
+}
+
+void TrailBuffer::Capacity(std::size_t samples)
+{
+    m_capacity = samples;
+    m_head = 0;
+    m_size = 0;
+    m_data.clear();
+    if (samples == 0)
+    {
+        m_data.shrink_to_fit();
+    }
+}
+
+std::size_t TrailBuffer::Head() const
+{
+    return m_head;
+}
+
+std::size_t TrailBuffer::Size() const
+{
+    return m_size;
+}
+
+const std::vector<double>& TrailBuffer::Data() const
+{
+    return m_data;
+}
+
+void TrailBuffer::Reserve(std::size_t count)
+{
+    m_data.reserve(2 * count * m_capacity);
+}
+
+std::size_t TrailBuffer::MemoryBytes() const
+{
+    return m_data.capacity() * sizeof(double);
+}
+
+void TrailBuffer::Reset(const double* x, const double* y, std::size_t count)
+{
+    m_head = 0;
+    m_size = 0;
+    Append(x, y, count);
+}
+
+void TrailBuffer::Append(const double* x, const double* y, std::size_t count)
+{
+    if (m_capacity == 0 || count <= m_size)
+    {
+        return;
+    }
+    m_data.resize(2 * count * m_capacity);
+    for (std::size_t i = m_size; i < count; ++i)
+    {
+        double* ring = m_data.data() + 2 * i * m_capacity;
+        for (std::size_t s = 0; s < m_capacity; ++s)
+        {
+            ring[2 * s] = x[i];
+            ring[2 * s + 1] = y[i];
+        }
+    }
+    m_size = count;
+}
+
+void TrailBuffer::RemoveMarked(const std::vector<unsigned char>& removed)
+{
+    if (m_capacity == 0)
+    {
+        return;
+    }
+    const std::size_t stride = 2 * m_capacity;
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < m_size; ++i)
+    {
+        if (!removed[i])
+        {
+            if (kept != i)
+            {
+                std::copy_n(m_data.data() + i * stride, stride, m_data.data() + kept * stride);
+            }
+            ++kept;
+        }
+    }
+    m_size = kept;
+    m_data.resize(kept * stride);
+}
+
+void TrailBuffer::PopBack()
+{
+    if (m_capacity == 0 || m_size == 0)
+    {
+        return;
+    }
+    --m_size;
+    m_data.resize(2 * m_size * m_capacity);
+}
+
+void TrailBuffer::Swap(std::size_t i, std::size_t j)
+{
+    if (m_capacity == 0 || i >= m_size || j >= m_size)
+    {
+        return;
+    }
+    const std::size_t stride = 2 * m_capacity;
+    std::swap_ranges(m_data.begin() + i * stride, m_data.begin() + (i + 1) * stride, m_data.begin() + j * stride);
+}
+
+void TrailBuffer::Permute(const std::vector<std::size_t>& order, std::vector<unsigned char>& scratch)
+{
+    const std::size_t count = order.size();
+    if (m_capacity == 0 || count > m_size)
+    {
+        return;
+    }
+    // As PermuteColumn, with a ring in place of each value
+    const std::size_t ringBytes = 2 * m_capacity * sizeof(double);
+    scratch.resize(count * ringBytes);
+    unsigned char* gathered = scratch.data();
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(m_data.data());
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        std::memcpy(gathered + i * ringBytes, data + order[i] * ringBytes, ringBytes);
+    }
+    if (count > 0)
+    {
+        std::memcpy(m_data.data(), gathered, count * ringBytes);
+    }
+}
+
+void TrailBuffer::Record(const double* x, const double* y, std::size_t count)
+{
+    if (m_capacity == 0)
+    {
+        return;
+    }
+    // Bodies added since the last sample start with a ring at their current position
+    Append(x, y, count);
+    const std::size_t stride = 2 * m_capacity;
+    double* slot = m_data.data() + 2 * m_head;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        slot[i * stride] = x[i];
+        slot[i * stride + 1] = y[i];
+    }
+    m_head = (m_head + 1) % m_capacity;
+}
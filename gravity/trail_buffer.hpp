@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Fixed capacity ring of each body's most recent positions, recorded by the simulation every few steps so
+// renderers can draw trails straight from the engine's memory. Every body is sampled at the same time, so
+// one head index is shared by all of them. Positions are interleaved x, y with each body's ring contiguous:
+// body i's sample s is at Data()[2 * (i * Capacity() + s)]. Head() is the slot the next sample goes in, so
+// the samples run oldest to newest from Head() around to Head() - 1. Until a body has been around for a
+// full ring its unwritten slots hold the position it was added at.
+class TrailBuffer
+{
+public:
+    TrailBuffer();
+
+    // Samples kept per body, 0 turns recording off and frees the buffer
+    std::size_t Capacity() const;
+    void Capacity(std::size_t samples);
+
+    std::size_t Head() const;
+    // Number of bodies with a ring
+    std::size_t Size() const;
+    const std::vector<double>& Data() const;
+
+    // Allocates rings for up to count bodies at the current capacity up front
+    void Reserve(std::size_t count);
+    std::size_t MemoryBytes() const;
+
+    // Fills every body's ring with its current position
+    void Reset(const double* x, const double* y, std::size_t count);
+    // Gives the bodies from Size() up to count a ring filled with their current position
+    void Append(const double* x, const double* y, std::size_t count);
+    // Drops the rings of the bodies marked in removed, keeping the order of the rest (see BodyStore::RemoveMarked)
+    void RemoveMarked(const std::vector<unsigned char>& removed);
+    // Drops the ring of the last body (see BodyStore::PopBack)
+    void PopBack();
+    // Exchanges the rings of bodies i and j (see BodyStore::Swap)
+    void Swap(std::size_t i, std::size_t j);
+    // Moves the ring of body order[i] to body i for each i < order.size(), scratch is working space (see
+    // BodyStore::Permute)
+    void Permute(const std::vector<std::size_t>& order, std::vector<unsigned char>& scratch);
+    // Writes the position of each body at the head and advances it
+    void Record(const double* x, const double* y, std::size_t count);
+
+private:
+    std::size_t m_capacity;
+    std::size_t m_head;
+    std::size_t m_size;
+    std::vector<double> m_data;
+};
@@ -1,102 +1,84 @@
 #pragma once
 
 #include <array>
-#include <iostream>
-
-#include "math.h"
-
-#include "vector_exc.hpp"
+#include <cmath>
+#include <ostream>
+#include <type_traits>
 
 // Vector Template
+// A plain value type: trivially copyable (copies are register moves), with everything but the norms
+// usable in constant expressions and nothing that can throw. Components missing from a constructor are 0.
 template<class TYPE, unsigned int DIM>
 class Vector
 {
 public:
-    // Constructors & Destructors
-    Vector() : m_data(std::array<TYPE, DIM>{0}) {};
-    Vector(const Vector<TYPE, DIM>& vector)
-    {
-        std::copy(vector.begin(), vector.end(), begin());
-    }
-
-    Vector(TYPE arg1) : m_data({arg1})
-    {
-    }
+    // Constructors
+    constexpr Vector() noexcept : m_data{} {}
 
-    Vector(TYPE arg1, TYPE arg2) : m_data({arg1, arg2})
+    constexpr explicit Vector(TYPE arg1) noexcept : m_data{{arg1}}
     {
     }
 
-    Vector(TYPE arg1, TYPE arg2, TYPE arg3) : m_data({arg1, arg2, arg3})
+    constexpr Vector(TYPE arg1, TYPE arg2) noexcept : m_data{{arg1, arg2}}
     {
+        static_assert(DIM >= 2, "Too many components for the vector");
     }
 
-    Vector(TYPE arg1, TYPE arg2, TYPE arg3, TYPE arg4) : m_data({arg1, arg2, arg3, arg4})
+    constexpr Vector(TYPE arg1, TYPE arg2, TYPE arg3) noexcept : m_data{{arg1, arg2, arg3}}
     {
+        static_assert(DIM >= 3, "Too many components for the vector");
     }
 
-    Vector(std::initializer_list<TYPE> data)
+    constexpr Vector(TYPE arg1, TYPE arg2, TYPE arg3, TYPE arg4) noexcept : m_data{{arg1, arg2, arg3, arg4}}
     {
-        if (data.size() > DIM)
-        {
-            throw XVectorDimensionIncorrect(DIM, data.size());
-        }
-        std::copy(data.begin(), data.end(), begin());
+        static_assert(DIM >= 4, "Too many components for the vector");
     }
 
-    ~Vector() {};
-
     // Basic Properties
-    int Size()
+    static constexpr unsigned int Size() noexcept
     {
-        return m_data.size();
-    }
-
-    // Validation
-    int IsEqualLength(const Vector& vec)
-    {
-        return m_data.size() == vec.Size();
+        return DIM;
     }
 
     // Random Access Operators
-    TYPE& operator[] (unsigned int n)
+    constexpr TYPE& operator[] (unsigned int n) noexcept
     {
         return m_data[n];
     }
 
-    const TYPE& operator[] (unsigned int n) const
+    constexpr const TYPE& operator[] (unsigned int n) const noexcept
     {
         return m_data[n];
     }
 
     // Iterators
-    typename std::array<TYPE, DIM>::iterator begin()
+    constexpr typename std::array<TYPE, DIM>::iterator begin() noexcept
     {
         return m_data.begin();
     }
 
-    typename std::array<TYPE, DIM>::const_iterator begin() const
+    constexpr typename std::array<TYPE, DIM>::const_iterator begin() const noexcept
     {
         return m_data.begin();
     }
 
-    typename std::array<TYPE, DIM>::iterator end()
+    constexpr typename std::array<TYPE, DIM>::iterator end() noexcept
     {
         return m_data.end();
     }
 
-    typename std::array<TYPE, DIM>::const_iterator end() const
+    constexpr typename std::array<TYPE, DIM>::const_iterator end() const noexcept
     {
         return m_data.end();
     }
 
     // Arithmetic Operators
-    friend Vector<TYPE, DIM> operator+(Vector<TYPE, DIM> lhs, const Vector<TYPE, DIM>& rhs)
+    friend constexpr Vector<TYPE, DIM> operator+(Vector<TYPE, DIM> lhs, const Vector<TYPE, DIM>& rhs) noexcept
     {
         return lhs += rhs;
     }
 
-    Vector<TYPE, DIM>& operator+=(const Vector<TYPE, DIM>& rhs)
+    constexpr Vector<TYPE, DIM>& operator+=(const Vector<TYPE, DIM>& rhs) noexcept
     {
         for (unsigned int i = 0; i < DIM; ++i)
         {
@@ -105,12 +87,12 @@ public:
         return *this;
     }
 
-    friend Vector<TYPE, DIM> operator-(Vector<TYPE, DIM> lhs, const Vector<TYPE, DIM>& rhs)
+    friend constexpr Vector<TYPE, DIM> operator-(Vector<TYPE, DIM> lhs, const Vector<TYPE, DIM>& rhs) noexcept
     {
         return lhs -= rhs;
     }
 
-    Vector<TYPE, DIM>& operator-=(const Vector<TYPE, DIM>& rhs)
+    constexpr Vector<TYPE, DIM>& operator-=(const Vector<TYPE, DIM>& rhs) noexcept
     {
         for (unsigned int i = 0; i < DIM; ++i)
         {
@@ -120,17 +102,17 @@ public:
     }
 
     // Multiplication with other types
-    friend Vector<TYPE, DIM> operator*(Vector lhs, const TYPE& rhs)
+    friend constexpr Vector<TYPE, DIM> operator*(Vector lhs, const TYPE& rhs) noexcept
     {
         return lhs *= rhs;
     }
 
-    friend Vector<TYPE, DIM> operator*(const TYPE& lhs, Vector rhs)
+    friend constexpr Vector<TYPE, DIM> operator*(const TYPE& lhs, Vector rhs) noexcept
     {
         return rhs *= lhs;
     }
 
-    Vector<TYPE, DIM>& operator*=(const TYPE& rhs)
+    constexpr Vector<TYPE, DIM>& operator*=(const TYPE& rhs) noexcept
     {
         for (unsigned int i = 0; i < DIM; ++i)
         {
@@ -169,56 +151,70 @@ public:
     //   return *this;
     //}
 
-    // TODO: Scalar multiplication
+    friend constexpr Vector<TYPE, DIM> operator-(Vector<TYPE, DIM> vector) noexcept
+    {
+        return vector *= static_cast<TYPE>(-1);
+    }
 
-    // Assignment operator
-    Vector<TYPE, DIM>& operator=(const Vector<TYPE, DIM>& other)
+    // Stream operator (for printing)
+    friend std::ostream& operator<<(std::ostream& os, const Vector<TYPE, DIM>& vector)
     {
+        os << "[";
         for (unsigned int i = 0; i < DIM; ++i)
         {
-            m_data[i] = other[i];
+            os << (i == 0 ? "" : ", ") << vector[i];
         }
-        return *this;
+        return os << "]";
     }
 
-    // Stream operator (for printing)
-    friend std::ostream& operator<<(std::ostream& os, const Vector<TYPE, DIM>& vector);
-
     // Comparison operators
-    // TODO: Implement ==
-    // TODO: Implement !=
+    friend constexpr bool operator==(const Vector<TYPE, DIM>& lhs, const Vector<TYPE, DIM>& rhs) noexcept
+    {
+        for (unsigned int i = 0; i < DIM; ++i)
+        {
+            if (lhs[i] != rhs[i])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    friend constexpr bool operator!=(const Vector<TYPE, DIM>& lhs, const Vector<TYPE, DIM>& rhs) noexcept
+    {
+        return !(lhs == rhs);
+    }
 
     // Mathematical Validation functions
     // TODO: Implement Parallel check - opposite direction but not necessarily the same magnitude
     // TODO: Implement AntiParallel check - same direction but not necessarily the same magnitude
 
     // Opposite check - same magnitude but opposite direction
-    bool IsOpposite(Vector<TYPE, DIM> vector)
+    constexpr bool IsOpposite(const Vector<TYPE, DIM>& vector) const noexcept
     {
-        bool validateMagnitude = Norm() == vector.Norm();
-        bool validateDirection = m_data[0] == -vector[0] && m_data[1] == -vector[1];
-        return validateMagnitude && validateDirection;
+        // Negation is exact, so matching components means matching magnitudes too
+        return *this == -vector;
     }
 
     // Opposite
-    Vector<TYPE, DIM> Opposite()
+    constexpr Vector<TYPE, DIM> Opposite() const noexcept
     {
-        return Vector<TYPE, DIM>({-m_data[0], -m_data[1]});
+        return -*this;
     }
 
     // Mathematical vector operations
-    TYPE NormSquared()
+    constexpr TYPE NormSquared() const noexcept
     {
         // The euclidean norm squared - the sum of the squares of all the vector elements
         TYPE result = static_cast<TYPE>(0);
-        for (auto& data : m_data)
+        for (unsigned int i = 0; i < DIM; ++i)
         {
-            result += data*data;
+            result += m_data[i]*m_data[i];
         }
         return result;
     }
 
-    TYPE Norm()
+    TYPE Norm() const noexcept
     {
         // Also known as length or magnitude
         // The euclidean norm - defined as the square root of sum of the squares of all the vector elements
@@ -226,25 +222,20 @@ public:
         return std::sqrt(NormSquared());
     }
 
-    void Normalise()
+    void Normalise() noexcept
     {
-        auto magnitude = Norm();
-        for (auto i=0; i<DIM; ++i)
+        const TYPE magnitude = Norm();
+        for (unsigned int i = 0; i < DIM; ++i)
         {
             m_data[i] /= magnitude;
         }
     }
 
-    // Dot/Scalar Product a . b
-    friend TYPE DotProduct(const Vector<TYPE, DIM>& lhs, const Vector<TYPE, DIM>& rhs)
+    // Dot/Scalar Product a . b, both vectors have the same dimension by construction
+    friend constexpr TYPE DotProduct(const Vector<TYPE, DIM>& lhs, const Vector<TYPE, DIM>& rhs) noexcept
     {
-        if (!lhs.IsEqualLength(rhs))
-        {
-            throw XVectorDimensionMismatch(lhs.Size(), rhs.Size());
-        }
-
         TYPE result = static_cast<TYPE>(0);
-        for (int i = 0; i < lhs.Size(); ++i)
+        for (unsigned int i = 0; i < DIM; ++i)
         {
             result += lhs[i] * rhs[i];
         }
@@ -252,10 +243,9 @@ public:
     }
 
     // Angle between two vectors (using dot product) - radians
-    friend TYPE AngleBetween(const Vector<TYPE, DIM>& lhs, const Vector<TYPE, DIM>& rhs)
+    friend TYPE AngleBetween(const Vector<TYPE, DIM>& lhs, const Vector<TYPE, DIM>& rhs) noexcept
     {
-        // Validates size in DotProduct
-        return acos(DotProduct(lhs, rhs) / (lhs.Norm() * rhs.Norm()));
+        return std::acos(DotProduct(lhs, rhs) / (lhs.Norm() * rhs.Norm()));
     }
 
     // TODO: Cross/Vector Product (2&3 dims only)
@@ -266,17 +256,11 @@ private:
 
 };
 
-template<class TYPE, unsigned int DIM>
-std::ostream& operator<<(std::ostream& os, const Vector<TYPE, DIM>& vector)
-{
-    os << "[";
-    for (auto it = vector.begin(); it != vector.end(); it++)
-    {
-        os << *it << ", ";
-    }
-    os << "]";
-}
-
 typedef Vector<double, 2> Vector2;
 typedef Vector<double, 3> Vector3;
 typedef Vector<double, 4> Vector4;
+
+// The body store keeps columns of these and the force code passes them around by value
+static_assert(std::is_trivially_copyable<Vector2>::value, "Vector2 must stay trivially copyable");
+static_assert(std::is_trivially_copyable<Vector3>::value, "Vector3 must stay trivially copyable");
+static_assert(sizeof(Vector2) == 2 * sizeof(double), "Vector2 must be exactly two packed doubles");
@@ -0,0 +1,475 @@
+// Headless runner for the gravity core, used for benchmarking and profiling the engine natively
+// e.g. gravity_run --scenario ring --bodies 2000 --steps 100
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "force_kernel.hpp"
+#include "scenario.hpp"
+#include "simulation.hpp"
+
+namespace
+{
+    struct RunnerOptions
+    {
+        std::string Scenario = "four";
+        std::string Restart;
+        std::string Checkpoint;
+        std::string Trace;
+        bool Profile = false;
+        unsigned int Steps = 1000;
+        double Dt = 0.0;
+        ScenarioOptions Generation = { 1000, 42 };
+        bool Soften = false;
+        bool ForceSoften = false;
+        Simulation::IntegrationMethod Integrator = Simulation::IntegrationMethod::Leapfrog;
+        Simulation::ForceSolver Solver = Simulation::ForceSolver::DirectSum;
+        Simulation::ForcePrecision Precision = Simulation::ForcePrecision::Double;
+        double Theta = 0.5;
+        unsigned int MeshSize = 256;
+        unsigned int StaticGrid = 256;
+        unsigned int BlockLevels = 0;
+        double TimestepAccuracy = 0.02;
+        bool Collisions = false;
+        bool CheckTheta = false;
+        unsigned int Threads = 1;
+        bool Energy = true;
+        unsigned int DiagnosticsInterval = 0;
+        std::size_t Reserve = 0;
+        unsigned int Reorder = 0;
+        Simulation::CullPolicy Culling = Simulation::CullPolicy::Keep;
+        double Bounds = 0.0;
+    };
+
+    const char* SolverName(Simulation::ForceSolver solver)
+    {
+        switch (solver)
+        {
+            case Simulation::ForceSolver::BarnesHut:
+                return "barneshut";
+            case Simulation::ForceSolver::ParticleMesh:
+                return "pm";
+            default:
+                return "direct";
+        }
+    }
+
+    const char* IntegratorName(Simulation::IntegrationMethod integrator)
+    {
+        switch (integrator)
+        {
+            case Simulation::IntegrationMethod::Euler:
+                return "euler";
+            case Simulation::IntegrationMethod::Taylor:
+                return "taylor";
+            case Simulation::IntegrationMethod::Yoshida:
+                return "yoshida";
+            case Simulation::IntegrationMethod::Omelyan:
+                return "omelyan";
+            case Simulation::IntegrationMethod::Hermite:
+                return "hermite";
+            default:
+                return "leapfrog";
+        }
+    }
+
+    void PrintUsage(const char* exe)
+    {
+        std::cout << "Usage: " << exe << " [options]\n"
+                  << "  --scenario <name|file>        Built-in scenario (" << BuiltInScenarios() << ") or scenario file (default: four)\n"
+                  << "  --restart <file>              Start from a checkpoint instead of a scenario\n"
+                  << "  --checkpoint <file>           Write a checkpoint after the last step\n"
+                  << "  --steps <n>                   Number of steps to run (default: 1000)\n"
+                  << "  --dt <value>                  Override the timestep of the scenario\n"
+                  << "  --bodies <n>                  Body count for generated scenarios (default: 1000)\n"
+                  << "  --seed <n>                    Random seed for generated scenarios (default: 42)\n"
+                  << "  --soften <0|1>                Override the softening setting of the scenario\n"
+                  << "  --integrator <name>           Integrator, euler, taylor, leapfrog, yoshida, omelyan or hermite (default: leapfrog)\n"
+                  << "  --solver <name>               Force solver, direct, barneshut or pm (default: direct)\n"
+                  << "  --precision <double|mixed>    Precision of the direct sum force pass (default: double)\n"
+                  << "  --theta <value>               Barnes-Hut opening angle (default: 0.5)\n"
+                  << "  --mesh <n>                    Particle-mesh grid nodes per side (default: 256)\n"
+                  << "  --static-grid <n>             Grid nodes per side for the field of many static bodies, 0 sums exactly (default: 256)\n"
+                  << "  --check-theta <0|1>           Report the Barnes-Hut error against direct summation for a range of theta\n"
+                  << "  --block <levels>              Block timesteps down to dt/2^levels, 0 for a single global step (default: 0)\n"
+                  << "  --eta <value>                 Block timestep accuracy parameter (default: 0.02)\n"
+                  << "  --collisions <0|1>            Merge bodies that touch (default: 0)\n"
+                  << "  --threads <n>                 Threads used for force evaluation, 0 for one per core (default: 1)\n"
+                  << "  --energy <0|1>                Report the initial and final energy, O(N^2) (default: 1)\n"
+                  << "  --diagnostics <k>             Accumulate energy/momentum diagnostics every k steps (default: 0, off)\n"
+                  << "  --profile <0|1>               Report the time spent in each phase of the steps (default: 0)\n"
+                  << "  --trace <file>                Write the timed phases of every step as Chrome trace event JSON\n"
+                  << "  --reserve <n>                 Allocate memory for n bodies before loading (default: 0, grow as needed)\n"
+                  << "  --cull <keep|remove|freeze>   What becomes of bodies escaping the bounds (default: keep)\n"
+                  << "  --bounds <half size>          Override the simulation bounds with a square about the origin\n"
+                  << "  --reorder <k>                 Sort the bodies along a Morton curve every k steps (default: 0, never)\n"
+                  << "  --help                        Show this message\n";
+    }
+
+    bool ParseArgs(int argc, char** argv, RunnerOptions& options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h")
+            {
+                PrintUsage(argv[0]);
+                std::exit(EXIT_SUCCESS);
+            }
+
+            if (i + 1 >= argc)
+            {
+                std::cerr << "Missing value for " << arg << "\n";
+                return false;
+            }
+            const std::string value = argv[++i];
+
+            if (arg == "--scenario")
+            {
+                options.Scenario = value;
+            }
+            else if (arg == "--restart")
+            {
+                options.Restart = value;
+            }
+            else if (arg == "--checkpoint")
+            {
+                options.Checkpoint = value;
+            }
+            else if (arg == "--trace")
+            {
+                options.Trace = value;
+            }
+            else if (arg == "--profile")
+            {
+                options.Profile = value != "0";
+            }
+            else if (arg == "--static-grid")
+            {
+                options.StaticGrid = static_cast<unsigned int>(std::stoul(value));
+            }
+            else if (arg == "--reserve")
+            {
+                options.Reserve = static_cast<std::size_t>(std::stoull(value));
+            }
+            else if (arg == "--cull")
+            {
+                if (value == "keep")
+                {
+                    options.Culling = Simulation::CullPolicy::Keep;
+                }
+                else if (value == "remove")
+                {
+                    options.Culling = Simulation::CullPolicy::Remove;
+                }
+                else if (value == "freeze")
+                {
+                    options.Culling = Simulation::CullPolicy::Freeze;
+                }
+                else
+                {
+                    std::cerr << "Unknown cull policy " << value << "\n";
+                    return false;
+                }
+            }
+            else if (arg == "--bounds")
+            {
+                options.Bounds = std::stod(value);
+            }
+            else if (arg == "--reorder")
+            {
+                options.Reorder = static_cast<unsigned int>(std::stoul(value));
+            }
+            else if (arg == "--steps")
+            {
+                options.Steps = static_cast<unsigned int>(std::stoul(value));
+            }
+            else if (arg == "--dt")
+            {
+                options.Dt = std::stod(value);
+            }
+            else if (arg == "--bodies")
+            {
+                options.Generation.BodyCount = static_cast<unsigned int>(std::stoul(value));
+            }
+            else if (arg == "--seed")
+            {
+                options.Generation.Seed = static_cast<unsigned int>(std::stoul(value));
+            }
+            else if (arg == "--soften")
+            {
+                options.ForceSoften = true;
+                options.Soften = value != "0";
+            }
+            else if (arg == "--integrator")
+            {
+                bool found = false;
+                for (auto integrator : { Simulation::IntegrationMethod::Euler, Simulation::IntegrationMethod::Taylor,
+                                         Simulation::IntegrationMethod::Leapfrog, Simulation::IntegrationMethod::Yoshida,
+                                         Simulation::IntegrationMethod::Omelyan, Simulation::IntegrationMethod::Hermite })
+                {
+                    if (value == IntegratorName(integrator))
+                    {
+                        options.Integrator = integrator;
+                        found = true;
+                    }
+                }
+                if (!found)
+                {
+                    std::cerr << "Unknown integrator " << value << "\n";
+                    return false;
+                }
+            }
+            else if (arg == "--solver")
+            {
+                if (value == "direct")
+                {
+                    options.Solver = Simulation::ForceSolver::DirectSum;
+                }
+                else if (value == "barneshut")
+                {
+                    options.Solver = Simulation::ForceSolver::BarnesHut;
+                }
+                else if (value == "pm")
+                {
+                    options.Solver = Simulation::ForceSolver::ParticleMesh;
+                }
+                else
+                {
+                    std::cerr << "Unknown solver " << value << "\n";
+                    return false;
+                }
+            }
+            else if (arg == "--precision")
+            {
+                if (value == "double")
+                {
+                    options.Precision = Simulation::ForcePrecision::Double;
+                }
+                else if (value == "mixed")
+                {
+                    options.Precision = Simulation::ForcePrecision::Mixed;
+                }
+                else
+                {
+                    std::cerr << "Unknown precision " << value << "\n";
+                    return false;
+                }
+            }
+            else if (arg == "--theta")
+            {
+                options.Theta = std::stod(value);
+            }
+            else if (arg == "--mesh")
+            {
+                options.MeshSize = static_cast<unsigned int>(std::stoul(value));
+            }
+            else if (arg == "--block")
+            {
+                options.BlockLevels = static_cast<unsigned int>(std::stoul(value));
+            }
+            else if (arg == "--eta")
+            {
+                options.TimestepAccuracy = std::stod(value);
+            }
+            else if (arg == "--collisions")
+            {
+                options.Collisions = value != "0";
+            }
+            else if (arg == "--threads")
+            {
+                options.Threads = static_cast<unsigned int>(std::stoul(value));
+            }
+            else if (arg == "--energy")
+            {
+                options.Energy = value != "0";
+            }
+            else if (arg == "--diagnostics")
+            {
+                options.DiagnosticsInterval = static_cast<unsigned int>(std::stoul(value));
+            }
+            else if (arg == "--check-theta")
+            {
+                options.CheckTheta = value != "0";
+            }
+            else
+            {
+                std::cerr << "Unknown option " << arg << "\n";
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    RunnerOptions options;
+    try
+    {
+        if (!ParseArgs(argc, argv, options))
+        {
+            PrintUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Invalid argument: " << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    Simulation sim(options.Integrator);
+    std::string error;
+    // Solver settings go first, changing them discards the accelerations a checkpoint restores
+    sim.Solver(options.Solver);
+    sim.Precision(options.Precision);
+    sim.Theta(options.Theta);
+    sim.MeshSize(options.MeshSize);
+    sim.StaticFieldGrid(options.StaticGrid);
+    sim.BlockTimesteps(options.BlockLevels > 0);
+    sim.MaxTimestepLevel(options.BlockLevels);
+    sim.TimestepAccuracy(options.TimestepAccuracy);
+    sim.Collisions(options.Collisions);
+    sim.Threads(options.Threads);
+    sim.DiagnosticsInterval(options.DiagnosticsInterval);
+    sim.ReorderInterval(options.Reorder);
+    sim.Culling(options.Culling);
+    const auto setupStart = std::chrono::steady_clock::now();
+    sim.Reserve(options.Reserve);
+    const bool loaded = options.Restart.empty() ? LoadScenario(sim, options.Scenario, options.Generation, error)
+                                                : sim.Load(options.Restart, error);
+    if (!loaded)
+    {
+        std::cerr << error << "\n";
+        return EXIT_FAILURE;
+    }
+    const double setupSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - setupStart).count();
+    if (options.ForceSoften)
+    {
+        sim.soften(options.Soften);
+    }
+    if (options.Dt > 0.0)
+    {
+        sim.dt(options.Dt);
+    }
+    if (options.Bounds > 0.0)
+    {
+        sim.SetSimBounds(-options.Bounds, options.Bounds, -options.Bounds, options.Bounds);
+    }
+
+    if (options.CheckTheta)
+    {
+        std::cout << "theta  rms relative error\n";
+        for (double theta : { 0.1, 0.2, 0.3, 0.5, 0.7, 1.0 })
+        {
+            std::cout << theta << "    " << sim.BarnesHutError(theta) << "\n";
+        }
+    }
+
+    const double initialEnergy = options.Energy ? sim.Energy() : 0.0;
+
+    sim.Profile().Tracing(!options.Trace.empty());
+    const SimulationMemory memoryBefore = sim.MemoryUsage();
+    const auto start = std::chrono::steady_clock::now();
+    sim.Step(options.Steps);
+    const auto end = std::chrono::steady_clock::now();
+    const SimulationMemory memoryAfter = sim.MemoryUsage();
+
+    const double seconds = std::chrono::duration<double>(end - start).count();
+
+    double checkpointSeconds = 0.0;
+    if (!options.Checkpoint.empty())
+    {
+        const auto checkpointStart = std::chrono::steady_clock::now();
+        if (!sim.Save(options.Checkpoint, error))
+        {
+            std::cerr << error << "\n";
+            return EXIT_FAILURE;
+        }
+        checkpointSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - checkpointStart).count();
+    }
+    if (!options.Trace.empty())
+    {
+        std::ofstream trace(options.Trace);
+        sim.Profile().WriteTrace(trace);
+        if (!trace)
+        {
+            std::cerr << "Couldn't write " << options.Trace << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+    const double interactions = static_cast<double>(sim.InteractionCount());
+    const double megabyte = 1024.0 * 1024.0;
+    const double finalEnergy = options.Energy ? sim.Energy() : 0.0;
+
+    std::cout << "Scenario:          " << (options.Restart.empty() ? options.Scenario : options.Restart) << "\n"
+              << "Bodies:            " << sim.BodyCount() << " (" << sim.StaticCount() << " static)\n"
+              << "Integrator:        " << IntegratorName(sim.Integrator()) << "\n"
+              << "Solver:            " << SolverName(sim.Solver()) << "\n"
+              << "Precision:         " << (sim.Precision() == Simulation::ForcePrecision::Mixed ? "mixed" : "double") << "\n"
+              << "Threads:           " << sim.Threads() << "\n"
+              << "Direct sum kernel: " << DirectSumKernelName() << "\n"
+              << "Setup time (s):    " << setupSeconds << "\n"
+              << "Steps:             " << options.Steps << "\n"
+              << "Wall time (s):     " << seconds << "\n"
+              << "Steps/sec:         " << (seconds > 0.0 ? options.Steps / seconds : 0.0) << "\n"
+              << "Interactions/sec:  " << (seconds > 0.0 ? interactions / seconds : 0.0) << "\n"
+              << "Memory (MB):       " << memoryAfter.Total / megabyte << " (bodies " << memoryAfter.Bodies / megabyte
+              << ", scratch " << memoryAfter.Scratch / megabyte << ", trails " << memoryAfter.Trails / megabyte << ")\n"
+              << "Grown by run (MB): " << (static_cast<double>(memoryAfter.Total) - memoryBefore.Total) / megabyte << "\n";
+    if (!options.Checkpoint.empty())
+    {
+        std::cout << "Checkpoint (s):    " << checkpointSeconds << "\n";
+    }
+    if (options.Collisions)
+    {
+        std::cout << "Merges:            " << sim.MergeCount() << "\n";
+    }
+    if (options.Culling != Simulation::CullPolicy::Keep)
+    {
+        std::cout << "Culled:            " << sim.CullEvents().size() << "\n";
+    }
+    if (options.Energy)
+    {
+        std::cout << "Initial energy:    " << initialEnergy << "\n"
+                  << "Final energy:      " << finalEnergy << "\n"
+                  << "Energy drift:      " << (initialEnergy != 0.0 ? (finalEnergy - initialEnergy) / std::abs(initialEnergy) : 0.0) << "\n";
+    }
+    if (options.DiagnosticsInterval > 0)
+    {
+        const SimulationDiagnostics& diagnostics = sim.Diagnostics();
+        std::cout << "Diagnostics at step " << diagnostics.StepCount << "\n"
+                  << "  Kinetic energy:   " << diagnostics.KineticEnergy << "\n"
+                  << "  Potential energy: " << diagnostics.PotentialEnergy << "\n"
+                  << "  Total energy:     " << diagnostics.TotalEnergy << "\n"
+                  << "  Momentum:         (" << diagnostics.MomentumX << ", " << diagnostics.MomentumY << ")\n"
+                  << "  Angular momentum: " << diagnostics.AngularMomentum << "\n";
+    }
+    if (options.Profile)
+    {
+        const Profiler& profiler = sim.Profile();
+        if (!Profiler::Enabled)
+        {
+            std::cout << "Profiling was disabled at compile time (GRAVITY_PROFILING)\n";
+        }
+        std::cout << "Allocations:       " << profiler.Allocations() << "\n"
+                  << "Phase              calls      total (ms)  max (ms)\n";
+        for (int p = 0; p < Profiler::Phase::PhaseCount; ++p)
+        {
+            const Profiler::Phase phase = static_cast<Profiler::Phase>(p);
+            const Profiler::PhaseStats& stats = profiler.Stats(phase);
+            if (stats.Calls == 0)
+            {
+                continue;
+            }
+            std::cout << "  " << std::left << std::setw(17) << Profiler::PhaseName(phase) << std::setw(11) << stats.Calls
+                      << std::setw(12) << stats.TotalMs << stats.MaxMs << "\n";
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,214 @@
+#include "scenario.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "generators.hpp"
+
+namespace
+{
+    void PairScenario(Simulation& sim)
+    {
+        sim.G(5000);
+        sim.dt(0.01);
+        sim.AddBody(100, 1.0, Vector2(150, 0), Vector2(0, -300), false);
+        sim.AddBody(100, 1.0, Vector2(-150, 0), Vector2(0, 300), false);
+    }
+
+    void ThreeBodyScenario(Simulation& sim)
+    {
+        PairScenario(sim);
+        sim.AddBody(100, 1.0, Vector2(0, 150), Vector2(300, 0), false);
+    }
+
+    void FourBodyScenario(Simulation& sim)
+    {
+        sim.G(5000);
+        sim.dt(0.01);
+        const double initRadius = 250;
+        const double initVel = 150;
+        sim.AddBody(100, 1.0, Vector2(initRadius, 0), Vector2(0, -initVel), false);
+        sim.AddBody(100, 1.0, Vector2(-initRadius, 0), Vector2(0, initVel), false);
+        sim.AddBody(100, 1.0, Vector2(0, initRadius), Vector2(initVel, 0), false);
+        sim.AddBody(100, 1.0, Vector2(0, -initRadius), Vector2(-initVel, 0), false);
+    }
+
+    void RingScenario(Simulation& sim, const ScenarioOptions& options)
+    {
+        sim.G(5000);
+        sim.dt(0.001);
+        GenerateRing(sim, options.BodyCount, 1, 500, 1, 1, 0.5, 100, 100, options.Seed);
+    }
+
+    void CentralMassScenario(Simulation& sim, const ScenarioOptions& options)
+    {
+        sim.G(500);
+        sim.dt(0.001);
+        sim.AddBody(1e4, 5.0, Vector2(0.0, 0.0), Vector2(0.0, 0.0), true);
+        if (options.BodyCount > 1)
+        {
+            GenerateRing(sim, options.BodyCount - 1, 350, 450, 25.0, 75.0, 0.5, 4000, 4050, options.Seed);
+        }
+    }
+
+    void DiskScenario(Simulation& sim, const ScenarioOptions& options)
+    {
+        sim.G(5000);
+        sim.dt(0.001);
+        sim.soften(true);
+        GenerateUniformDisk(sim, options.BodyCount, 400, 1000, 0.5, options.Seed);
+    }
+
+    // Most of the bodies are fixed attractors, so nearly all of the force work is their cached field
+    void AttractorsScenario(Simulation& sim, const ScenarioOptions& options)
+    {
+        sim.G(5000);
+        sim.dt(0.001);
+        sim.soften(true);
+        sim.SetSimBounds(-400, 400, -400, 400);
+        const unsigned int testCount = std::max(1u, options.BodyCount / 10);
+        GenerateAttractorField(sim, options.BodyCount - std::min(testCount, options.BodyCount), testCount, 400, 1000,
+                               0.5, options.Seed);
+    }
+
+    void PlummerScenario(Simulation& sim, const ScenarioOptions& options)
+    {
+        sim.G(5000);
+        sim.dt(0.001);
+        sim.soften(true);
+        GeneratePlummer(sim, options.BodyCount, 100, 1000, 0.5, options.Seed);
+    }
+
+    void CollisionScenario(Simulation& sim, const ScenarioOptions& options)
+    {
+        sim.G(5000);
+        sim.dt(0.001);
+        sim.soften(true);
+        GenerateGalaxyCollision(sim, options.BodyCount / 2, 200, 500, 800, 500, 0.5, options.Seed);
+    }
+
+    // Scenario files are line based, blank lines and lines starting with # are ignored:
+    //   G <value>
+    //   dt <value>
+    //   soften <0|1>
+    //   bounds <xmin> <xmax> <ymin> <ymax>
+    //   body <mass> <radius> <x> <y> <vx> <vy> [static]
+    bool ScenarioFile(Simulation& sim, const std::string& path, std::string& error)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            error = "Unknown scenario or unreadable file: " + path;
+            return false;
+        }
+
+        std::string line;
+        unsigned int lineNumber = 0;
+        while (std::getline(file, line))
+        {
+            ++lineNumber;
+            std::istringstream tokens(line);
+            std::string key;
+            if (!(tokens >> key) || key[0] == '#')
+            {
+                continue;
+            }
+
+            bool ok = true;
+            if (key == "G")
+            {
+                double g;
+                ok = static_cast<bool>(tokens >> g);
+                if (ok) sim.G(g);
+            }
+            else if (key == "dt")
+            {
+                double dt;
+                ok = static_cast<bool>(tokens >> dt);
+                if (ok) sim.dt(dt);
+            }
+            else if (key == "soften")
+            {
+                int soften;
+                ok = static_cast<bool>(tokens >> soften);
+                if (ok) sim.soften(soften != 0);
+            }
+            else if (key == "bounds")
+            {
+                double xMin, xMax, yMin, yMax;
+                ok = static_cast<bool>(tokens >> xMin >> xMax >> yMin >> yMax);
+                if (ok) sim.SetSimBounds(xMin, xMax, yMin, yMax);
+            }
+            else if (key == "body")
+            {
+                double mass, radius, x, y, vx, vy;
+                ok = static_cast<bool>(tokens >> mass >> radius >> x >> y >> vx >> vy);
+                std::string flag;
+                const bool isStatic = (tokens >> flag) && flag == "static";
+                if (ok) sim.AddBody(mass, radius, Vector2(x, y), Vector2(vx, vy), isStatic);
+            }
+            else
+            {
+                ok = false;
+            }
+
+            if (!ok)
+            {
+                error = path + ":" + std::to_string(lineNumber) + ": cannot parse '" + line + "'";
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+bool LoadScenario(Simulation& sim, const std::string& nameOrPath, const ScenarioOptions& options, std::string& error)
+{
+    if (nameOrPath == "pair")
+    {
+        PairScenario(sim);
+    }
+    else if (nameOrPath == "three")
+    {
+        ThreeBodyScenario(sim);
+    }
+    else if (nameOrPath == "four")
+    {
+        FourBodyScenario(sim);
+    }
+    else if (nameOrPath == "ring")
+    {
+        RingScenario(sim, options);
+    }
+    else if (nameOrPath == "central")
+    {
+        CentralMassScenario(sim, options);
+    }
+    else if (nameOrPath == "disk")
+    {
+        DiskScenario(sim, options);
+    }
+    else if (nameOrPath == "attractors")
+    {
+        AttractorsScenario(sim, options);
+    }
+    else if (nameOrPath == "plummer")
+    {
+        PlummerScenario(sim, options);
+    }
+    else if (nameOrPath == "collision")
+    {
+        CollisionScenario(sim, options);
+    }
+    else
+    {
+        return ScenarioFile(sim, nameOrPath, error);
+    }
+    return true;
+}
+
+std::string BuiltInScenarios()
+{
+    return "pair, three, four, ring, central, disk, attractors, plummer, collision";
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+
+#include "simulation.hpp"
+
+struct ScenarioOptions
+{
+    unsigned int BodyCount;
+    unsigned int Seed;
+};
+
+// Populates the simulation with a named built-in scenario (the setups in browser/index.html plus the
+// engine's generated scenarios) or, if the name is not recognised, with the contents of a scenario file
+// of that name. Returns false if the scenario could not be loaded.
+bool LoadScenario(Simulation& sim, const std::string& nameOrPath, const ScenarioOptions& options, std::string& error);
+
+// Comma separated list of the built-in scenario names
+std::string BuiltInScenarios();